@@ -16,7 +16,9 @@ uniform vec4 ambient;
 out vec4 finalColor;
 
 void main() {
-    float diff = max(dot(normalize(sunPos-fragPosition),fragNormal),0.0);
+    // Single sided meshes are drawn without culling, light their back faces as if they had their own normals
+    vec3 normal = gl_FrontFacing ? fragNormal : -fragNormal;
+    float diff = max(dot(normalize(sunPos-fragPosition),normal),0.0);
     vec4 diffuse = vec4(diff*sunColor.xyz,sunColor.w);
 
     finalColor = (ambient+diffuse)*colorDiffuse*fragColor;
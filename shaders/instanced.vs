@@ -0,0 +1,23 @@
+#version 330
+
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in vec3 vertexNormal;
+in vec4 vertexColor;
+in mat4 instanceTransform;
+
+uniform mat4 mvp;
+
+out vec3 fragPosition;
+out vec2 fragTexCoord;
+out vec3 fragNormal;
+out vec4 fragColor;
+
+void main() {
+    fragPosition = vec3(instanceTransform*vec4(vertexPosition,1.0));
+    fragTexCoord = vertexTexCoord;
+    fragNormal = normalize(mat3(instanceTransform)*vertexNormal); // Objects are only scaled uniformly
+    fragColor = vertexColor;
+
+    gl_Position = mvp*vec4(fragPosition,1.0);
+}
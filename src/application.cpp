@@ -14,12 +14,28 @@
 #include "logging.hpp"
 #include "object/consistent/cube.hpp"
 #include "player/maincamera.hpp"
+#include "render/asset_cache.hpp"
+#include "render/mesh_disk_cache.hpp"
+#include "render/mesh_queue.hpp"
 #include "object/consistent/move_tool.hpp"
 #include "object/procedural/spline.hpp"
+#include "object/procedural/tapered_petal.hpp"
 
 constexpr int DEFAULT_SCREEN_WIDTH = 1280;
 constexpr int DEFAULT_SCREEN_HEIGHT = 720;
 constexpr int FONT_SIZE = 40;
+const std::string MESH_CACHE_PATH = "cache/meshes/";
+constexpr uintmax_t MESH_CACHE_BYTES = 256ull*1024*1024;
+constexpr float MESH_UPLOAD_BUDGET_MS = 2.0f; // main thread time per frame for uploading meshes built in the background
+constexpr float STATIC_BATCH_UPLOAD_BUDGET_MS = 1.0f;
+// Petal surfaces may deviate this far (world units) from the full grid, which roughly halves their triangles
+constexpr float PETAL_TESSELLATION_TOLERANCE = 0.002f;
+constexpr bool PETAL_SINGLE_SIDED = true; // half the petal vertices, the shader lights the back faces
+constexpr VertexFormat PETAL_VERTEX_FORMAT = VertexFormat::COMPACT; // 16 bytes per vertex instead of 36
+// Seconds between runs of each scheduled subsystem, 0 is every tick
+constexpr float NETWORK_FLUSH_INTERVAL = 0.0f;
+constexpr float WEATHER_UPDATE_INTERVAL = 300.0f;
+constexpr float AUTOSAVE_INTERVAL = 120.0f;
 
 Application::Application() : ip_({0}), port_({0}), username_({0}), ip_focus_(false), port_focus_(false), username_focus_(false) {
     DEBUG("Initializing window with size " + std::to_string(DEFAULT_SCREEN_WIDTH) + "," + std::to_string(DEFAULT_SCREEN_HEIGHT));
@@ -42,6 +58,18 @@ Application::Application() : ip_({0}), port_({0}), username_({0}), ip_focus_(fal
             delete s;
         }
     );
+    shader_instanced_ = std::shared_ptr<Shader>(
+        new Shader(LoadShader("shaders/instanced.vs","shaders/default.fs")),
+        [](Shader* s) {
+            UnloadShader(*s);
+            delete s;
+        }
+    );
+    shader_instanced_->locs[SHADER_LOC_COLOR_DIFFUSE] = GetShaderLocation(*shader_instanced_, "colorDiffuse");
+    shader_instanced_->locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(*shader_instanced_, "instanceTransform");
+    instance_batcher_ = std::make_unique<InstanceBatcher>(shader_instanced_);
+    MeshDiskCache::open(MESH_CACHE_PATH, MESH_CACHE_BYTES);
+    TaperedPetal::set_default_mesh_options(PetalMeshOptions{PETAL_TESSELLATION_TOLERANCE, PETAL_SINGLE_SIDED, PETAL_VERTEX_FORMAT});
 }
 
 void Application::tick(std::map<std::string, std::shared_ptr<Event>>& event_buffer, Game& game) {
@@ -56,35 +84,43 @@ void Application::run(Game& game) {
     DEBUG("Starting application...");
     MainCamera main_camera {};
 
-    const float TPS = 20.0f; // ticks per second
-    float dt_tick = 0; // time elapsed since last tick (seconds)
-    uint64_t total_ticks = 0;
+    tick_scheduler_.add_task(NETWORK_FLUSH_INTERVAL, [this, &game]() {tick(event_buffer_, game);});
+    tick_scheduler_.add_task(WEATHER_UPDATE_INTERVAL, [&game]() {
+        if (game.get_network()->is_host()) {
+            const auto weather = game.get_world()->get_weather();
+            game.get_network_thread().request_weather(weather->get_latitude(), weather->get_longitude());
+        }
+    });
+    // The world was just loaded from the save, so the first one is due an interval in
+    tick_scheduler_.add_task(AUTOSAVE_INTERVAL, [&game]() {
+        if (game.get_network()->is_host())
+            game.save();
+    }, false);
 
-    const int WEATHER_UPDATE_INTERVAL = 300; // (seconds)
-    uint64_t last_weather_update = 0;
+    uint32_t weather_revision = 0; // last network thread weather fetch applied to the world
 
     const int UI_UPDATE_INTERVAL = 1; // (seconds)
     uint64_t last_ui_update = 0;
 
-    int sun_position_loc = GetShaderLocation(*shader_default_,"sunPos");
-    int sun_color_loc = GetShaderLocation(*shader_default_,"sunColor");
-    int ambient_loc = GetShaderLocation(*shader_default_,"ambient");
-
-    SetShaderValue(*shader_default_, sun_position_loc, (float[3]){0.0f,game.get_world()->get_sun()->get_position().y,0.0f}, SHADER_UNIFORM_VEC3);
-    SetShaderValue(*shader_default_, sun_color_loc, (float[4]){1.0f,1.0f,1.0f,1.0f}, SHADER_UNIFORM_VEC4);
-    SetShaderValue(*shader_default_, ambient_loc, (float[4]){1.0f,1.0f,0.75f,1.0f}, SHADER_UNIFORM_VEC4);
+    float initial_sun_pos[3] = {0.0f,game.get_world()->get_sun()->get_position().y,0.0f};
+    float initial_sun_color[4] = {1.0f,1.0f,1.0f,1.0f};
+    float initial_ambient[4] = {1.0f,1.0f,0.75f,1.0f};
+    set_lighting_uniform("sunPos", initial_sun_pos, SHADER_UNIFORM_VEC3);
+    set_lighting_uniform("sunColor", initial_sun_color, SHADER_UNIFORM_VEC4);
+    set_lighting_uniform("ambient", initial_ambient, SHADER_UNIFORM_VEC4);
 
     std::string fps_buffer;
+    std::vector<std::string> stats_lines; // debug overlay, one labeled line each
 
     while (!WindowShouldClose()) {
         if (!game.in_world()) {
+            tick_scheduler_.reset();
             display_menu(game);
             continue;
         }
 
         uint64_t current_timestamp = std::time(nullptr);
         float dt = GetFrameTime(); // elapsed seconds of last frame (seconds)
-        dt_tick += dt;
 
         std::vector<bool> keybinds = {IsKeyDown(KEY_W), IsKeyDown(KEY_A), IsKeyDown(KEY_S), IsKeyDown(KEY_D), IsKeyDown(KEY_TAB), IsKeyDown(KEY_ESCAPE),
                                         IsMouseButtonPressed(MOUSE_LEFT_BUTTON), (GetMouseWheelMoveV().y > 0), (GetMouseWheelMoveV().y < 0), IsKeyPressed(KEY_SPACE), IsKeyDown(KEY_Q), IsKeyDown(KEY_E), IsKeyPressed(KEY_R)};
@@ -97,11 +133,13 @@ void Application::run(Game& game) {
         }
 
         player->update(event_buffer_, main_camera, game.get_world(), keybinds, dt);
-        if (dt_tick >= 1.0f/TPS) {
-            if (current_timestamp-last_weather_update >= WEATHER_UPDATE_INTERVAL && game.get_network()->is_host()) {
-                bool updated = game.get_world()->get_weather()->update();
-                if (updated) {
+        if (game.get_network_thread().update()) {
+            const NetworkSnapshot& snapshot = game.get_network_thread().get_snapshot();
+            if (snapshot.weather_revision != weather_revision) {
+                weather_revision = snapshot.weather_revision;
+                if (snapshot.weather_updated) {
                     DEBUG("Updating weather information in world and shader...");
+                    game.get_world()->get_weather()->set_weather_id(snapshot.weather_id);
                     event_buffer_["WeatherUpdateEvent"] = std::make_shared<WeatherUpdateEvent>(game.get_world()->get_weather()->get_weather_id());
                     game.get_world()->get_weather()->update_sun(current_timestamp);
                     game.get_world()->update_sun();
@@ -109,34 +147,36 @@ void Application::run(Game& game) {
                     // Pass new lighting information to shader
                     const Vector3 sun_position = game.get_world()->get_sun()->get_position();
                     float sun_pos[3] = {sun_position.x, sun_position.y, sun_position.z};
-                    SetShaderValue(*shader_default_, sun_position_loc, sun_pos, SHADER_UNIFORM_VEC3);
+                    set_lighting_uniform("sunPos", sun_pos, SHADER_UNIFORM_VEC3);
                     float sun_color[4] = {1.0f,1.0f,(std::pow(std::max(sun_position.y,0.0f),2)/10000.0f),1.0f};
-                    SetShaderValue(*shader_default_, sun_color_loc, sun_color, SHADER_UNIFORM_VEC4);
+                    set_lighting_uniform("sunColor", sun_color, SHADER_UNIFORM_VEC4);
 
                     float ambient_level = (std::pow(std::max(sun_position.y,0.0f),2)/10000.0f)*0.5f + 0.25f;
                     float ambient[4] = {ambient_level,ambient_level,ambient_level,1.0f};
-                    SetShaderValue(*shader_default_, ambient_loc, ambient, SHADER_UNIFORM_VEC4);
+                    set_lighting_uniform("ambient", ambient, SHADER_UNIFORM_VEC4);
                 } else {
                     WARN("Failed to retrieve weather information");
                 }
-                last_weather_update = current_timestamp;
             }
-            tick(event_buffer_, game);
-            dt_tick = 0;
-            total_ticks++;
         }
+        tick_scheduler_.update(dt);
         main_camera.update(player, GetMouseDelta());
+        MeshQueue::update(MESH_UPLOAD_BUDGET_MS);
+        const double time = GetTime();
+        for (const auto& other : game.get_world()->get_players())
+            other->interpolate(time);
+        game.get_world()->update_transforms();
+        game.get_world()->update_static_batches(time, STATIC_BATCH_UPLOAD_BUDGET_MS);
 
         float cam_pos[3] = {main_camera.get_position().x, main_camera.get_position().y, main_camera.get_position().z};
         SetShaderValue(*shader_default_, shader_default_->locs[SHADER_LOC_VECTOR_VIEW], cam_pos, SHADER_UNIFORM_VEC3);
+        SetShaderValue(*shader_instanced_, shader_instanced_->locs[SHADER_LOC_VECTOR_VIEW], cam_pos, SHADER_UNIFORM_VEC3);
 
         BeginDrawing();
 
         BeginMode3D(main_camera.get_camera());
         ClearBackground(SKYBLUE);
-        game.get_world()->get_sun()->draw();
-        draw_players(game.get_current_user(), game.get_world()->get_players(), main_camera);
-        draw_objects(game.get_world()->get_objects());
+        draw_world(game, main_camera);
         EndMode3D();
 
         // Crosshair
@@ -146,10 +186,22 @@ void Application::run(Game& game) {
         if (current_timestamp-last_ui_update >= UI_UPDATE_INTERVAL) {
             INFO("Updating FPS");
             fps_buffer = std::to_string((int)round(1.0f/dt));
+            stats_lines.clear();
+            stats_lines.push_back("draw: " + std::to_string(render_stats_.submitted) + " drawn " + std::to_string(render_stats_.culled) + " culled " + std::to_string(render_stats_.draw_calls) + " calls " + std::to_string(render_stats_.triangles) + " tris " + std::to_string(render_stats_.static_batches) + " batches of " + std::to_string(render_stats_.static_batched) + " static");
+            stats_lines.push_back("binds: " + std::to_string(render_stats_.shader_binds) + "/" + std::to_string(render_stats_.material_binds) + "/" + std::to_string(render_stats_.mesh_binds) + " shader/material/mesh");
+            stats_lines.push_back("meshes: " + std::to_string(render_stats_.mesh_queue) + " queued " + std::to_string(render_stats_.mesh_uploads) + " uploads " + std::to_string(render_stats_.mesh_upload_ms) + " ms " + std::to_string(render_stats_.mesh_bytes/1024) + " KB uploaded " + std::to_string(render_stats_.cache_miss_ratio) + " ACMR " + std::to_string(AssetCache::mesh_count()) + " meshes " + std::to_string(AssetCache::material_count()) + " materials");
+            const TickStats ticks = tick_scheduler_.get_stats();
+            stats_lines.push_back("ticks: " + std::to_string(ticks.tick_rate) + " tps " + std::to_string(ticks.p50_ms) + "/" + std::to_string(ticks.p95_ms) + "/" + std::to_string(ticks.max_ms) + " ms p50/p95/max " + std::to_string(ticks.skipped) + " skipped");
+            const NetworkSnapshot& network = game.get_network_thread().get_snapshot();
+            stats_lines.push_back("network: " + std::to_string(network.tick_ms) + " ms tick " + std::to_string(network.packets_sent) + " sent " + std::to_string(network.packets_received) + " received");
             last_ui_update = current_timestamp;
         }
         int fps_size = MeasureText(fps_buffer.c_str(),FONT_SIZE);
         GuiLabel((Rectangle){0,0,fps_size,FONT_SIZE},fps_buffer.c_str());
+        for (size_t i = 0; i < stats_lines.size(); i++) {
+            const float stats_size = static_cast<float>(MeasureText(stats_lines[i].c_str(),FONT_SIZE));
+            GuiLabel((Rectangle){0,static_cast<float>(FONT_SIZE*(i+1)),stats_size,FONT_SIZE},stats_lines[i].c_str());
+        }
 
         if (keybinds[4]) {display_scoreboard(game.get_world()->get_players());}
         EndDrawing();
@@ -223,23 +275,69 @@ void Application::display_scoreboard(const std::vector<std::shared_ptr<Player>>&
     }
 }
 
-void Application::draw_objects(const std::map<uint32_t, std::shared_ptr<Object3d>>& objects) {
-    for (const auto& p : objects) {
-        p.second->draw();
-    }
+// Everything in the 3D pass is collected first and drawn in one sorted flush, so draws sharing a shader,
+// material or mesh end up next to each other whatever order they were submitted in
+void Application::draw_world(Game& game, const MainCamera& main_camera) {
+    std::shared_ptr<World> world = game.get_world();
+    render_stats_ = RenderStats{};
+    instance_batcher_->begin(main_camera.get_lod_view(GetScreenHeight()));
+    world->get_sun()->submit(*instance_batcher_);
+    submit_players(game.get_current_user(), world->get_players(), main_camera);
+    submit_objects(world, main_camera.get_frustum((float)GetScreenWidth()/GetScreenHeight()));
+    instance_batcher_->flush();
+
+    render_stats_.draw_calls = instance_batcher_->get_draw_calls();
+    render_stats_.triangles = instance_batcher_->get_triangles();
+    const RenderQueueStats& render_queue_stats = instance_batcher_->get_queue_stats();
+    render_stats_.shader_binds = render_queue_stats.shader_binds;
+    render_stats_.material_binds = render_queue_stats.material_binds;
+    render_stats_.mesh_binds = render_queue_stats.mesh_binds;
+    const MeshQueueStats& queue_stats = MeshQueue::get_stats();
+    render_stats_.mesh_queue = queue_stats.queued;
+    render_stats_.mesh_uploads = queue_stats.uploaded;
+    render_stats_.mesh_upload_ms = queue_stats.upload_ms;
+    const MeshUploadStats& upload_stats = get_upload_stats();
+    render_stats_.mesh_bytes = upload_stats.bytes;
+    render_stats_.cache_miss_ratio = upload_stats.measured_triangles > 0 ? upload_stats.cache_misses/(float)upload_stats.measured_triangles : 0.0f;
 }
 
-void Application::draw_players(std::string current_user, const std::vector<std::shared_ptr<Player>>& players, const MainCamera& main_camera) {
-    for (const auto &player : players) {
-        player->draw(current_user, main_camera);
+void Application::submit_objects(std::shared_ptr<World> world, const Frustum& frustum) {
+    const auto& objects = world->get_objects();
+    const StaticBatcher& static_batches = world->get_static_batches();
+    const int draws_before = instance_batcher_->get_draw_calls();
+    static_batches.submit(*instance_batcher_, frustum);
+    render_stats_.static_batches = instance_batcher_->get_draw_calls() - draws_before;
+    render_stats_.static_batched = static_batches.get_stats().batched;
+    world->cull(frustum, visible_objects_);
+    for (uint32_t id : visible_objects_) {
+        if (!static_batches.is_batched(id))
+            objects.at(id)->submit(*instance_batcher_);
     }
+    render_stats_.submitted = visible_objects_.size();
+    render_stats_.culled = objects.size() - visible_objects_.size();
+}
+
+void Application::submit_players(std::string current_user, const std::vector<std::shared_ptr<Player>>& players, const MainCamera& main_camera) {
+    for (const auto &player : players)
+        player->submit(*instance_batcher_, current_user, main_camera);
 }
 
 void Application::exit() {
     DEBUG("Closing Window");
+    MeshQueue::clear();
     CloseWindow();
 }
 
+// Lit shaders share the sun and ambient uniforms
+void Application::set_lighting_uniform(const char* name, const void* value, int type) {
+    SetShaderValue(*shader_default_, GetShaderLocation(*shader_default_, name), value, type);
+    SetShaderValue(*shader_instanced_, GetShaderLocation(*shader_instanced_, name), value, type);
+}
+
 std::map<std::string, std::shared_ptr<Event>>& Application::get_event_buffer() {
     return event_buffer_;
+}
+
+TickScheduler& Application::get_tick_scheduler() {
+    return tick_scheduler_;
 }
\ No newline at end of file
@@ -5,6 +5,11 @@
 #include "game.hpp"
 #include "player/maincamera.hpp"
 #include "object/object3d.hpp"
+#include "render/frustum.hpp"
+#include "render/instance_batcher.hpp"
+#include "render/lod.hpp"
+#include "render/render_stats.hpp"
+#include "tick_scheduler.hpp"
 #include "world/world.hpp"
 
 class Application {
@@ -16,15 +21,24 @@ public:
     void run(Game& game);
     void display_menu(Game& game);
     void display_scoreboard(const std::vector<std::shared_ptr<Player>>& players);
-    void draw_objects(const std::map<uint32_t, std::shared_ptr<Object3d>>& objects);
-    void draw_players(std::string current_user, const std::vector<std::shared_ptr<Player>>& players, const MainCamera& main_camera);
+    void draw_world(Game& game, const MainCamera& main_camera);
+    void submit_objects(std::shared_ptr<World> world, const Frustum& frustum);
+    void submit_players(std::string current_user, const std::vector<std::shared_ptr<Player>>& players, const MainCamera& main_camera);
     void exit();
+    void set_lighting_uniform(const char* name, const void* value, int type);
 
     std::map<std::string, std::shared_ptr<Event>>& get_event_buffer();
+    TickScheduler& get_tick_scheduler();
 private:
     std::map<std::string, std::shared_ptr<Event>> event_buffer_;
     std::shared_ptr<Shader> shader_default_;
     std::shared_ptr<Shader> shader_light_source_;
+    std::shared_ptr<Shader> shader_instanced_;
+    std::unique_ptr<InstanceBatcher> instance_batcher_;
+
+    TickScheduler tick_scheduler_;
+    RenderStats render_stats_;
+    std::vector<uint32_t> visible_objects_;
 
     char ip_[16];
     char port_[6];
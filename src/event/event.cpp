@@ -11,8 +11,10 @@
 #include "object/consistent/move_tool.hpp"
 #include "object/consistent/sun_tool.hpp"
 #include "object/consistent/rotate_tool.hpp"
+#include "object/consistent/parameter_tool.hpp"
 #include "object/procedural/tapered_petal.hpp"
 #include "player/player.hpp"
+#include "render/mesh_queue.hpp"
 #include "util.hpp"
 #include "object/object3d.hpp"
 #include "object/procedural/lily_flower.hpp"
@@ -128,7 +130,7 @@ bool PlayerMoveEvent::reliable() const {
     return false;
 };
 void PlayerMoveEvent::receive(std::string receiving_user, std::shared_ptr<World> world, std::shared_ptr<Network> network, Game& game, uint64_t current_timestamp, std::map<std::string, std::shared_ptr<Event>>& event_buffer, MainCamera& camera, const std::vector<bool>& keybinds, float dt, std::shared_ptr<Shader> shader) {
-    world->get_player(username_)->set_position(Vector3{x_,y_,z_});
+    world->get_player(username_)->set_network_position(Vector3{x_,y_,z_});
     if (network->is_host()) {
         network->send_packet_excluding(make_packet(), reliable(), username_);
     }
@@ -194,6 +196,35 @@ void ObjectRotateEvent::add(uint32_t id, Quaternion quaternion){
     objects_[id] = quaternion;
 }
 
+ObjectParameterEvent::ObjectParameterEvent(std::map<std::tuple<uint32_t, int, std::string>, float> parameters, std::string sender) : parameters_(std::move(parameters)), sender_(sender) {}
+ObjectParameterEvent::ObjectParameterEvent(std::string packet) {
+    std::vector<std::string> split = split_string(packet);
+    sender_ = split[1];
+    for (int i = 2; i < split.size(); i++) {
+        std::vector<std::string> update = split_string(split[i]);
+        add(std::stoi(update[0]), std::stoi(update[1]), update[2], std::stof(update[3]));
+    }
+}
+ObjectParameterEvent::~ObjectParameterEvent() {}
+
+std::string ObjectParameterEvent::make_packet() const {
+    std::string result = "ObjectParameterEvent " + sender_ + " ";
+    for (const auto& [key, value] : parameters_)
+        result += "(" + std::to_string(std::get<0>(key)) + " " + std::to_string(std::get<1>(key)) + " " + std::get<2>(key) + " " + std::to_string(value) + ")";
+    return result;
+}
+bool ObjectParameterEvent::reliable() const {return true;}
+
+void ObjectParameterEvent::receive(std::string receiving_user, std::shared_ptr<World> world, std::shared_ptr<Network> network, Game& game, uint64_t current_timestamp, std::map<std::string, std::shared_ptr<Event>>& event_buffer, MainCamera& camera, const std::vector<bool>& keybinds, float dt, std::shared_ptr<Shader> shader) {
+    for (const auto& [key, value] : parameters_)
+        world->update_object(std::get<0>(key), std::get<1>(key), std::get<2>(key), value);
+    if (network->is_host())
+        network->send_packet_excluding(make_packet(), reliable(), sender_);
+}
+void ObjectParameterEvent::add(uint32_t id, int part, std::string parameter, float value) {
+    parameters_[{id, part, std::move(parameter)}] = value;
+}
+
 ObjectRemoveEvent::ObjectRemoveEvent(std::vector<uint32_t> indices, std::string sender) : indices_(std::move(indices)), sender_(sender) {}
 ObjectRemoveEvent::ObjectRemoveEvent(std::string packet) {
     std::vector<std::string> split = split_string(packet);
@@ -237,6 +268,8 @@ ObjectLoadEvent::ObjectLoadEvent(std::string packet) {
             object = std::make_shared<SunTool>(a[1]);
         } else if (type=="RotateTool") {
             object = std::make_shared<RotateTool>(a[1]);
+        } else if (type=="ParameterTool") {
+            object = std::make_shared<ParameterTool>(a[1]);
         } else if (type=="TaperedPetal") {
             object = std::make_shared<TaperedPetal>(a[1]);
         } else if (type=="LilyFlower") {
@@ -256,8 +289,12 @@ bool ObjectLoadEvent::reliable() const {
     return true;
 }
 void ObjectLoadEvent::receive(std::string receiving_user, std::shared_ptr<World> world, std::shared_ptr<Network> network, Game& game, uint64_t current_timestamp, std::map<std::string, std::shared_ptr<Event>>& event_buffer, MainCamera& camera, const std::vector<bool>& keybinds, float dt, std::shared_ptr<Shader> shader) {
-    for (const auto& p : objects_)
+    // Procedural objects arrive without meshes, they are built in the background and draw once uploaded
+    for (const auto& p : objects_) {
         world->load_object(p.second, p.first, shader);
+        if (auto procedural = std::dynamic_pointer_cast<ParameterObject>(p.second))
+            MeshQueue::enqueue(procedural);
+    }
     if (network->is_host())
         network->send_packet_excluding(make_packet(), reliable(), sender_);
 }
@@ -277,6 +314,8 @@ ItemPickupEvent::ItemPickupEvent(std::string packet) {
         item_ = std::make_shared<SunTool>(split[2]);
     } else if (type == "RotateTool") {
         item_ = std::make_shared<RotateTool>(split[2]);
+    } else if (type == "ParameterTool") {
+        item_ = std::make_shared<ParameterTool>(split[2]);
     }
 }
 ItemPickupEvent::~ItemPickupEvent() {}
@@ -336,4 +375,37 @@ void WeatherUpdateEvent::receive(std::string receiving_user, std::shared_ptr<Wor
         game.get_world()->get_weather()->update_sun(current_timestamp+timestamp_offset_);
         game.get_world()->update_sun();
     }
-}
\ No newline at end of file
+}
+
+std::unique_ptr<Event> make_event(const std::string& packet) {
+    assert(is_main_thread());
+    const std::vector<std::string> split = split_string(packet);
+    if (split[0] == "IAmHostEvent") {
+        return std::make_unique<IAmHostEvent>(split[1]);
+    } else if (split[0] == "ConnectEvent") {
+        return std::make_unique<ConnectEvent>(split[1]);
+    } else if (split[0] == "SyncEvent") {
+        return std::make_unique<SyncEvent>(packet);
+    } else if (split[0] == "DisconnectEvent") {
+        return std::make_unique<DisconnectEvent>(split[1]);
+    } else if (split[0] == "PlayerMoveEvent") {
+        return std::make_unique<PlayerMoveEvent>(packet);
+    } else if (split[0] == "ObjectMoveEvent") {
+        return std::make_unique<ObjectMoveEvent>(packet);
+    } else if (split[0] == "ObjectRotateEvent") {
+        return std::make_unique<ObjectRotateEvent>(packet);
+    } else if (split[0] == "ObjectParameterEvent") {
+        return std::make_unique<ObjectParameterEvent>(packet);
+    } else if (split[0] == "ObjectRemoveEvent") {
+        return std::make_unique<ObjectRemoveEvent>(packet);
+    } else if (split[0] == "ObjectLoadEvent") {
+        return std::make_unique<ObjectLoadEvent>(packet);
+    } else if (split[0] == "ItemPickupEvent") {
+        return std::make_unique<ItemPickupEvent>(packet);
+    } else if (split[0] == "ItemDropEvent") {
+        return std::make_unique<ItemDropEvent>(packet);
+    } else if (split[0] == "WeatherUpdateEvent") {
+        return std::make_unique<WeatherUpdateEvent>(packet);
+    }
+    return nullptr;
+}
@@ -3,6 +3,7 @@
 #include <memory>
 #include <cstdint>
 #include <string>
+#include <tuple>
 #include <vector>
 
 class Game;
@@ -114,6 +115,21 @@ private:
     std::string sender_;
 };
 
+// Parameter edits, later edits of the same parameter in a frame replace earlier ones
+class ObjectParameterEvent : public Event {
+public:
+    ObjectParameterEvent(std::map<std::tuple<uint32_t, int, std::string>, float> parameters, std::string sender);
+    ObjectParameterEvent(std::string packet);
+    ~ObjectParameterEvent();
+    std::string make_packet() const override;
+    bool reliable() const override;
+    void receive(std::string receiving_user, std::shared_ptr<World> world, std::shared_ptr<Network> network, Game& game, uint64_t current_timestamp, std::map<std::string, std::shared_ptr<Event>>& event_buffer, MainCamera& camera, const std::vector<bool>& keybinds, float dt, std::shared_ptr<Shader> shader) override;
+    void add(uint32_t id, int part, std::string parameter, float value);
+private:
+    std::map<std::tuple<uint32_t, int, std::string>, float> parameters_; // (object, part, parameter) -> value
+    std::string sender_;
+};
+
 class ObjectRemoveEvent : public Event {
 public:
     ObjectRemoveEvent(std::vector<uint32_t> indices, std::string sender);
@@ -179,4 +195,7 @@ public:
 private:
     int weather_id_;
     int timestamp_offset_;
-};
\ No newline at end of file
+};
+
+// The event a received packet describes, null for an unknown one. Main thread only, loading objects uploads meshes.
+std::unique_ptr<Event> make_event(const std::string& packet);
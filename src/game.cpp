@@ -1,10 +1,33 @@
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 
 #include "event/event.hpp"
 #include "game.hpp"
+#include "logging.hpp"
+#include "worker_pool.hpp"
 #include <cassert>
 
-Game::Game() : in_world_(false), current_user_("") {
+static const std::string SAVE_FILE = "test world.data";
+
+// Saves may finish out of order on the workers, an older one never overwrites a newer one
+static std::mutex save_mutex;
+static uint64_t next_save = 0; // main thread only
+static uint64_t written_save = 0;
+
+static void write_save(uint64_t revision, const std::string& data) {
+    std::lock_guard lock(save_mutex);
+    if (revision < written_save)
+        return;
+    std::ofstream file(SAVE_FILE);
+    file << data;
+    if (!file)
+        WARN("Failed to write " + SAVE_FILE);
+    written_save = revision;
+}
+
+Game::Game() : in_world_(false), current_user_(""), current_player_id_(0) {
     world_ = std::make_shared<World>();
     network_ = std::make_unique<Network>();
 };
@@ -14,14 +37,22 @@ bool Game::in_world() const {
 }
 
 void Game::poll_events(std::string receiving_user, std::shared_ptr<World> world, std::shared_ptr<Network> network, Game& game, uint64_t current_timestamp, std::map<std::string, std::shared_ptr<Event>>& event_buffer, MainCamera& camera, const std::vector<bool>& keybinds, float dt, std::shared_ptr<Shader> shader) {
-    std::unique_ptr<Event> event = network_->poll_events();
-    if (event == nullptr)
-        return;
-    event->receive(receiving_user,world,network,game,current_timestamp,event_buffer,camera,keybinds,dt,shader);
+    // Packets the network thread received, in order, until the budget runs out. At least one is applied
+    // every frame so a burst of slow ones (loading objects) cannot stall the queue.
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    std::string packet;
+    bool applied = false;
+    while ((!applied || std::chrono::duration<float, std::milli>(Clock::now() - start).count() < EVENT_BUDGET_MS) && network_->poll_packet(packet)) {
+        applied = true;
+        if (std::unique_ptr<Event> event = make_event(packet))
+            event->receive(receiving_user,world,network,game,current_timestamp,event_buffer,camera,keybinds,dt,shader);
+    }
 }
 
 bool Game::host(std::string current_user, std::string save_file, char* ip, char* port, std::shared_ptr<Shader> shader) {
     current_user_ = current_user;
+    current_player_id_ = 0;
     world_->load_world(save_file, shader);
     world_->load_player(current_user, shader);
     world_->set_alone(current_user);
@@ -29,17 +60,20 @@ bool Game::host(std::string current_user, std::string save_file, char* ip, char*
     if (success) {
         in_world_ = true;
         world_->get_player(current_user)->on_join();
+        network_thread_.start(network_);
     }
     return success;
 }
 
 bool Game::join(std::string current_user, char* ip, char* port) {
     current_user_ = current_user;
+    current_player_id_ = 0;
     bool success = network_->join_server(ip, port);
     if (success) {
         ConnectEvent event (current_user_);
         network_->send_packet(event.make_packet(), event.reliable());
         in_world_ = true;
+        network_thread_.start(network_);
     }
     return success;
 }
@@ -49,13 +83,20 @@ const std::string& Game::get_current_user() {
 }
 
 const std::shared_ptr<Player> Game::get_current_player() {
-    return world_->get_player(current_user_);
+    // Player ids are only stable until the world is reset (e.g. by a SyncEvent), so revalidate the cached one
+    std::shared_ptr<Player> player = world_->get_player(current_player_id_);
+    if (player == nullptr || player->get_username() != current_user_) {
+        current_player_id_ = world_->get_player_id(current_user_);
+        player = world_->get_player(current_player_id_);
+    }
+    return player;
 }
 
 void Game::disconnect() {
-    if (network_->is_host()) {
-        get_world()->save_world("test world.data");
-    }
+    network_thread_.stop();
+    // Written before returning, a save left on the pool would be dropped if the game closes next
+    if (network_->is_host())
+        write_save(++next_save, world_->to_string());
     network_->disconnect();
     in_world_ = false;
     EnableCursor();
@@ -67,4 +108,20 @@ std::shared_ptr<Network> Game::get_network() const {
 
 std::shared_ptr<World> Game::get_world() const {
     return world_;
-};
\ No newline at end of file
+};
+
+void Game::save() const {
+    auto data = std::make_shared<std::string>(world_->to_string());
+    const uint64_t revision = ++next_save;
+    WorkerPool::submit([revision, data]() {
+        try {
+            write_save(revision, *data);
+        } catch (...) {
+            WARN("Failed to write " + SAVE_FILE);
+        }
+    });
+}
+
+NetworkThread& Game::get_network_thread() {
+    return network_thread_;
+}
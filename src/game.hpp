@@ -4,10 +4,13 @@
 #include <vector>
 
 #include "network/network.hpp"
+#include "network_thread.hpp"
 #include "object/object3d.hpp"
 #include "player/player.hpp"
 #include "world/world.hpp"
 
+constexpr float EVENT_BUDGET_MS = 4.0f; // time per frame for applying received packets, the rest wait
+
 class Game {
 public:
     Game();
@@ -18,16 +21,21 @@ public:
     bool join(std::string current_user, char* ip, char* port);
 
     void disconnect();
+    // Serializes the world here and writes it on a worker
+    void save() const;
 
     const std::string& get_current_user();
     const std::shared_ptr<Player> get_current_player();
 
     std::shared_ptr<Network> get_network() const;
     std::shared_ptr<World> get_world() const;
+    NetworkThread& get_network_thread();
 private:
     bool in_world_;
     std::shared_ptr<World> world_;
     std::string current_user_;
+    uint32_t current_player_id_;
 
     std::shared_ptr<Network> network_;
-};
\ No newline at end of file
+    NetworkThread network_thread_; // runs the network while in a world
+};
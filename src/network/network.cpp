@@ -21,120 +21,125 @@ Network::~Network() {
     enet_deinitialize();
 }
 
-std::unique_ptr<Event> Network::poll_events() {
-    std::unique_ptr<Event> result = nullptr;
+bool Network::poll_packet(std::string& packet) {
+    std::lock_guard lock(queue_mutex_);
+    if (incoming_.empty())
+        return false;
+    packet = std::move(incoming_.front());
+    incoming_.pop_front();
+    return true;
+}
+
+NetworkTraffic Network::service() {
+    NetworkTraffic traffic;
     if (mode_ == 0)
-        return result;
+        return traffic;
+    traffic.sent = flush_outgoing();
     ENetEvent event;
+    // A client that lost the server has its host destroyed by receive
+    while (mode_ != 0 && enet_host_service(host_,&event,0) > 0) {
+        std::string result = receive(event);
+        if (result.empty())
+            continue;
+        std::lock_guard lock(queue_mutex_);
+        incoming_.push_back(std::move(result));
+        traffic.received++;
+    }
+    return traffic;
+}
+
+// Only the peer bookkeeping happens here, the packet goes to the main thread as it came
+std::string Network::receive(ENetEvent& event) {
+    std::string result;
     std::vector<std::string> split {};
-    int i = 0;
     std::string* username;
-    if (enet_host_service(host_,&event,0) > 0) {
-        std::string data;
-        switch (event.type) {
-        case ENET_EVENT_TYPE_CONNECT:
-            DEBUG("New connection: " + std::to_string(event.peer->address.host) + ", " + std::to_string(event.peer->address.port));
-            break;
-        case ENET_EVENT_TYPE_RECEIVE:
-            data = std::string((char*)event.packet->data, event.packet->dataLength-1);
-            INFO("Packet of length " + std::to_string(event.packet->dataLength) + " containing {" + data + "} received from " + std::to_string(event.peer->address.host));
-            split = split_string(data);
-            if (split[0] == "IAmHostEvent") {
-                result = std::make_unique<IAmHostEvent>(split[1]);
-                username = new std::string(split[1]);
-                players_[split[1]] = event.peer;
-                event.peer->data = (void*) (username);
-            } else if (split[0] == "ConnectEvent") {
-                result = std::make_unique<ConnectEvent>(split[1]);
-                if (is_host()) {
-                    username = new std::string(split[1]);
-                    players_[split[1]] = event.peer;
-                    event.peer->data = (void*) (username);
-                }
-            } else if (split[0] == "SyncEvent") {
-                result = std::make_unique<SyncEvent>(data);
-            } else if (split[0] == "DisconnectEvent") {
-                result = std::make_unique<DisconnectEvent>(split[1]);
-            } else if (split[0] == "PlayerMoveEvent") {
-                result = std::make_unique<PlayerMoveEvent>(data);
-            } else if (split[0] == "ObjectMoveEvent") {
-                result = std::make_unique<ObjectMoveEvent>(data);
-            } else if (split[0] == "ObjectRotateEvent") {
-                result = std::make_unique<ObjectRotateEvent>(data);
-            } else if (split[0] == "ObjectRemoveEvent") {
-                result = std::make_unique<ObjectRemoveEvent>(data); 
-            } else if (split[0] == "ObjectLoadEvent") {
-                result = std::make_unique<ObjectLoadEvent>(data); 
-            } else if (split[0] == "ItemPickupEvent") {
-                result = std::make_unique<ItemPickupEvent>(data); 
-            } else if (split[0] == "ItemDropEvent") {
-                result = std::make_unique<ItemDropEvent>(data);
-            } else if (split[0] == "WeatherUpdateEvent") {
-                result = std::make_unique<WeatherUpdateEvent>(data);
-            }
-            enet_packet_destroy (event.packet);
-            break;
-        case ENET_EVENT_TYPE_DISCONNECT:
-            username = (std::string*)event.peer->data;
-            DEBUG("Disconnection: " + std::to_string(event.peer->address.host) + "," + std::to_string(event.peer->address.port) + ", data: " + *username);
-            result = std::make_unique<DisconnectEvent>(*username);
-            if (is_host()) {
-                players_.erase(*username);
-            } else {
-                enet_host_destroy(host_);
-                mode_ = 0;
-            }
-            delete (std::string*)event.peer->data;
+    switch (event.type) {
+    case ENET_EVENT_TYPE_CONNECT:
+        DEBUG("New connection: " + std::to_string(event.peer->address.host) + ", " + std::to_string(event.peer->address.port));
+        break;
+    case ENET_EVENT_TYPE_RECEIVE:
+        result = std::string((char*)event.packet->data, event.packet->dataLength-1);
+        INFO("Packet of length " + std::to_string(event.packet->dataLength) + " containing {" + result + "} received from " + std::to_string(event.peer->address.host));
+        split = split_string(result);
+        if (split[0] == "IAmHostEvent" || (split[0] == "ConnectEvent" && is_host())) {
+            username = new std::string(split[1]);
+            players_[split[1]] = event.peer;
+            event.peer->data = (void*) (username);
         }
+        enet_packet_destroy (event.packet);
+        break;
+    case ENET_EVENT_TYPE_DISCONNECT:
+        username = (std::string*)event.peer->data;
+        DEBUG("Disconnection: " + std::to_string(event.peer->address.host) + "," + std::to_string(event.peer->address.port) + ", data: " + *username);
+        result = DisconnectEvent(*username).make_packet();
+        if (is_host()) {
+            players_.erase(*username);
+        } else {
+            enet_host_destroy(host_);
+            mode_ = 0;
+        }
+        delete (std::string*)event.peer->data;
     }
-    return std::move(result);
+    return result;
 }
 
 void Network::send_packet(std::string data, bool reliable) const {
-    if (mode_ == 0)
-        return;
-    ENetPacket* packet = enet_packet_create(data.c_str(), data.size()+1, reliable);
-    if (mode_ == 1) {
-        for (const auto& pair : players_) {
-            assert(pair.second != nullptr);
-            enet_peer_send(pair.second, 0, packet);
-        }
-    } else if (mode_ == 2) {
-        assert(server_ != nullptr);
-        enet_peer_send(server_, 0, packet);
-    }
-    INFO("Sent packet with: " + data);
+    std::lock_guard lock(queue_mutex_);
+    outgoing_.push_back({std::move(data), reliable, Recipients::ALL, ""});
 }
 
 void Network::send_packet_excluding(std::string data, bool reliable, std::string exclude) const {
+    std::lock_guard lock(queue_mutex_);
+    outgoing_.push_back({std::move(data), reliable, Recipients::EXCLUDING, std::move(exclude)});
+}
+
+void Network::send_packet(std::string data, bool reliable, std::string target_username) const {
+    std::lock_guard lock(queue_mutex_);
+    outgoing_.push_back({std::move(data), reliable, Recipients::ONE, std::move(target_username)});
+}
+
+int Network::flush_outgoing() {
+    std::vector<OutgoingPacket> packets;
+    {
+        std::lock_guard lock(queue_mutex_);
+        packets.swap(outgoing_);
+    }
+    for (const OutgoingPacket& packet : packets)
+        send_now(packet);
+    return packets.size();
+}
+
+// Left over from the last session
+void Network::clear_queues() {
+    std::lock_guard lock(queue_mutex_);
+    outgoing_.clear();
+    incoming_.clear();
+}
+
+// Players may have left since the packet was queued, a packet nobody took is freed here
+void Network::send_now(const OutgoingPacket& outgoing) {
     if (mode_ == 0)
         return;
-    ENetPacket* packet = enet_packet_create(data.c_str(), data.size()+1, reliable);
+    ENetPacket* packet = enet_packet_create(outgoing.data.c_str(), outgoing.data.size()+1, outgoing.reliable);
     if (mode_ == 1) {
         for (const auto& pair : players_) {
             assert(pair.second != nullptr);
-            if (pair.first == exclude)
+            if ((outgoing.recipients == Recipients::EXCLUDING && pair.first == outgoing.username) || (outgoing.recipients == Recipients::ONE && pair.first != outgoing.username))
                 continue;
             enet_peer_send(pair.second, 0, packet);
         }
-    } else if (mode_ == 2) {
-        // RelayEvent
-    }
-}
-
-void Network::send_packet(std::string data, bool reliable, std::string target_username) const {
-    if (mode_ == 0)
-        return;
-    ENetPacket* packet = enet_packet_create(data.c_str(), data.size()+1, reliable);
-    if (mode_ == 1) {
-        assert(players_.find(target_username) != players_.end());
-        enet_peer_send(players_.at(target_username), 0, packet);
-    } else if (mode_ == 2) {
-        // RelayEvent
-    }
+    } else if (mode_ == 2 && outgoing.recipients == Recipients::ALL) {
+        assert(server_ != nullptr);
+        enet_peer_send(server_, 0, packet);
+    } // RelayEvent
+    if (packet->referenceCount == 0)
+        enet_packet_destroy(packet);
+    else
+        INFO("Sent packet with: " + outgoing.data);
 }
 
 bool Network::host_server(std::string ip, std::string port) {
+    clear_queues();
     ENetAddress address;
     address.host = ENET_HOST_ANY;
     address.port = std::stoi(port);
@@ -150,6 +155,7 @@ bool Network::host_server(std::string ip, std::string port) {
 
 
 bool Network::join_server(std::string ip, std::string port) {
+    clear_queues();
     ENetAddress address;
     enet_address_set_host(&address, ip.c_str());
     address.port = std::stoi(port);
@@ -187,6 +193,7 @@ bool Network::is_host() const {
 void Network::disconnect() {
     if (mode_ == 0)
         return;
+    flush_outgoing();
     if (!is_host()) {
         if (!server_) {
             enet_host_destroy(host_);
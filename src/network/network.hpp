@@ -1,8 +1,11 @@
 #pragma once
+#include <atomic>
+#include <deque>
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
 
 #include "event/event.hpp"
 
@@ -10,16 +13,30 @@ struct _ENetHost;
 typedef struct _ENetHost ENetHost;
 struct _ENetPeer;
 typedef struct _ENetPeer ENetPeer;
+struct _ENetEvent;
+typedef struct _ENetEvent ENetEvent;
 
+struct NetworkTraffic {
+    int sent = 0; // packets handed to ENet
+    int received = 0; // packets queued for poll_packet
+};
+
+// While in a world the ENet host belongs to whichever thread calls service, everything else only touches the
+// queues. Outside of one (hosting, joining, disconnecting) the calls all come from the main thread.
 class Network {
 public:
     Network();
     ~Network();
 
-    std::unique_ptr<Event> poll_events();
+    // Next packet received by service, false when there is none. Kept raw so the events, which may load
+    // objects, are only built on the main thread.
+    bool poll_packet(std::string& packet);
+    // Sends are queued and go out with the next service
     void send_packet(std::string data, bool reliable) const;
     void send_packet_excluding(std::string data, bool reliable, std::string exclude) const;
     void send_packet(std::string data, bool reliable, std::string target_username) const;
+    // Sends everything queued and receives everything pending
+    NetworkTraffic service();
     bool host_server(std::string ip, std::string port);
     bool join_server(std::string ip, std::string port);
     bool is_online(std::string username) const;
@@ -28,9 +45,27 @@ public:
 
     void delete_server();
 private:
+    enum class Recipients {ALL, EXCLUDING, ONE};
+    struct OutgoingPacket {
+        std::string data;
+        bool reliable;
+        Recipients recipients;
+        std::string username; // excluded or only recipient
+    };
+
+    // The packet to queue, empty when there is none
+    std::string receive(ENetEvent& event);
+    int flush_outgoing();
+    void clear_queues();
+    void send_now(const OutgoingPacket& packet);
+
     bool initialized_;
-    int mode_; // 0 - none, 1 - host, 2 - join
+    std::atomic<int> mode_; // 0 - none, 1 - host, 2 - join
     ENetHost* host_;
     ENetPeer* server_;
     std::map<std::string, ENetPeer*> players_;
+
+    mutable std::mutex queue_mutex_;
+    mutable std::vector<OutgoingPacket> outgoing_;
+    std::deque<std::string> incoming_;
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include <chrono>
+
+#include "network/network.hpp"
+#include "network_thread.hpp"
+#include "world/weather.hpp"
+
+struct WeatherFetch {
+    std::atomic<bool> done = false;
+    bool success = false;
+    int weather_id = 0;
+};
+
+NetworkThread::~NetworkThread() {
+    stop();
+}
+
+void NetworkThread::start(std::shared_ptr<Network> network) {
+    stop();
+    network_ = std::move(network);
+    weather_requested_ = false;
+    stopping_ = false;
+    thread_ = std::thread(&NetworkThread::run, this);
+}
+
+void NetworkThread::stop() {
+    if (!thread_.joinable())
+        return;
+    stopping_ = true;
+    thread_.join();
+}
+
+bool NetworkThread::is_running() const {
+    return thread_.joinable();
+}
+
+void NetworkThread::request_weather(float latitude, float longitude) {
+    std::lock_guard<std::mutex> lock(weather_mutex_);
+    weather_requested_ = true;
+    latitude_ = latitude;
+    longitude_ = longitude;
+}
+
+bool NetworkThread::update() {
+    return snapshots_.acquire();
+}
+
+const NetworkSnapshot& NetworkThread::get_snapshot() const {
+    return snapshots_.read_slot();
+}
+
+bool NetworkThread::take_weather_request(float& latitude, float& longitude) {
+    std::lock_guard<std::mutex> lock(weather_mutex_);
+    if (!weather_requested_)
+        return false;
+    weather_requested_ = false;
+    latitude = latitude_;
+    longitude = longitude_;
+    return true;
+}
+
+void NetworkThread::run() {
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.0f/NETWORK_TICK_RATE));
+    Clock::time_point next_tick = Clock::now();
+    // The request runs on a thread of its own, not the worker pool, so a slow server holds up neither the
+    // network nor mesh builds. Nothing joins it, the fetch owns its result and outlives a stop.
+    std::shared_ptr<WeatherFetch> fetch;
+    NetworkSnapshot snapshot;
+    snapshot.weather_revision = weather_revision_;
+    while (!stopping_) {
+        const Clock::time_point start = Clock::now();
+        NetworkTraffic traffic = network_->service();
+        snapshot.packets_sent += traffic.sent;
+        snapshot.packets_received += traffic.received;
+
+        float latitude;
+        float longitude;
+        if (fetch == nullptr && take_weather_request(latitude, longitude)) {
+            fetch = std::make_shared<WeatherFetch>();
+            std::thread([fetch, latitude, longitude]() {
+                try {
+                    Weather weather(latitude, longitude);
+                    fetch->success = weather.update();
+                    fetch->weather_id = weather.get_weather_id();
+                } catch (...) {
+                    fetch->success = false;
+                }
+                fetch->done = true;
+            }).detach();
+        }
+        if (fetch != nullptr && fetch->done) {
+            snapshot.weather_revision = ++weather_revision_;
+            snapshot.weather_updated = fetch->success;
+            if (fetch->success)
+                snapshot.weather_id = fetch->weather_id;
+            fetch.reset();
+        }
+
+        snapshot.tick++;
+        snapshot.tick_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+        snapshots_.write_slot() = snapshot;
+        snapshots_.publish();
+
+        next_tick += interval;
+        if (next_tick < Clock::now())
+            next_tick = Clock::now();
+        std::this_thread::sleep_until(next_tick);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "triple_buffer.hpp"
+
+class Network;
+
+constexpr float NETWORK_TICK_RATE = 60.0f; // network services per second while in a world
+
+// Everything the network thread has to tell the main thread, published once per tick
+struct NetworkSnapshot {
+    uint64_t tick = 0;
+    float tick_ms = 0.0f; // time the tick's own work took
+    uint64_t packets_sent = 0; // since the thread started
+    uint64_t packets_received = 0;
+    uint32_t weather_revision = 0; // bumped by every finished fetch, successful or not
+    bool weather_updated = false; // whether the latest fetch succeeded
+    int weather_id = 0;
+};
+
+// Fixed-rate thread for the work that needs neither the GL context nor the world: servicing the network
+// and fetching the weather when asked to, which blocks for as long as the HTTP request takes. Packets it
+// receives wait in the Network queue as raw strings, the main thread turns them into events and applies
+// them. The world itself stays on the main thread: loaded objects upload their meshes through AssetCache
+// and MeshQueue, and Player::update reads raylib input, so there is no world state to snapshot or
+// interpolate here beyond what remote players already interpolate. The rest comes out as snapshots the
+// main thread reads without locking. A tick that overruns delays the next one instead of piling up.
+class NetworkThread {
+public:
+    NetworkThread() = default;
+    ~NetworkThread();
+    NetworkThread(const NetworkThread&) = delete;
+    NetworkThread& operator=(const NetworkThread&) = delete;
+
+    void start(std::shared_ptr<Network> network);
+    // Returns once the thread has finished its current tick, the network is the caller's again
+    void stop();
+    bool is_running() const;
+    // Fetches the weather on its own thread, the result arrives in a later snapshot. Ignored while a fetch is running.
+    void request_weather(float latitude, float longitude);
+
+    // Main thread. Takes the newest snapshot if one was published since the last call, returns whether
+    // there was one.
+    bool update();
+    const NetworkSnapshot& get_snapshot() const;
+private:
+    void run();
+    bool take_weather_request(float& latitude, float& longitude);
+
+    std::shared_ptr<Network> network_;
+    std::mutex weather_mutex_; // guards the request
+    bool weather_requested_ = false;
+    float latitude_ = 0.0f;
+    float longitude_ = 0.0f;
+    uint32_t weather_revision_ = 0; // kept across restarts so the render thread never sees an old revision again
+    std::thread thread_;
+    std::atomic<bool> stopping_ = false;
+    TripleBuffer<NetworkSnapshot> snapshots_;
+};
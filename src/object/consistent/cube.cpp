@@ -2,6 +2,7 @@
 #include <string>
 
 #include "object/consistent/cube.hpp"
+#include "render/asset_cache.hpp"
 #include "util.hpp"
 
 #include "raymath.h"
@@ -16,15 +17,13 @@ Cube::Cube(std::string data) {
     scale_ = std::stof(split[7]);
     color_ = Color{(unsigned char)std::stoi(split[8]), (unsigned char)std::stoi(split[9]), (unsigned char)std::stoi(split[10]), (unsigned char)std::stoi(split[11])};
     quaternion_ = Quaternion{std::stof(split[12]),std::stof(split[13]),std::stof(split[14]),std::stof(split[15])};
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshCube(size_.x, size_.y, size_.z);
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = color_;
+    set_mesh(AssetCache::cube(size_));
+    set_color(color_);
     update_matrix();
 }
 Cube::Cube(Vector3 position, Vector3 size, float scale, Color color) : Object3d(position, scale), size_(size), color_(color) {
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshCube(size_.x, size_.y, size_.z);
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = color_;
+    set_mesh(AssetCache::cube(size_));
+    set_color(color_);
     update_matrix();
 }
 
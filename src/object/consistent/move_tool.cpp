@@ -9,14 +9,14 @@
 #include "object/consistent/cube.hpp"
 #include "object/consistent/move_tool.hpp"
 #include "player/maincamera.hpp"
+#include "render/asset_cache.hpp"
 #include "util.hpp"
 
 MoveTool::MoveTool() : Item(), holding_distance_(2.0f) {
     held_id_ = 0;
     speed_ = 2.0f;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = GREEN;
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshCylinder(0.25f,0.5f,10);
+    set_color(GREEN);
+    set_mesh(AssetCache::cylinder(0.25f,0.5f,10));
     update_matrix();
 }
 
@@ -29,18 +29,16 @@ MoveTool::MoveTool(std::string data) : Item() {
     quaternion_ = Quaternion{std::stof(split[6]),std::stof(split[7]),std::stof(split[8]),std::stof(split[9])};
     held_id_ = 0;
     speed_ = 2.0f;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = GREEN;
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshCylinder(0.25f,0.5f,10);
+    set_color(GREEN);
+    set_mesh(AssetCache::cylinder(0.25f,0.5f,10));
     update_matrix();
 }
 
 MoveTool::MoveTool(Vector3 position, float scale) : Item(position,scale), holding_distance_(2.0f) {
     held_id_ = 0;
     speed_ = 2.0f;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = GREEN;
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshCylinder(0.25f,0.5f,10);
+    set_color(GREEN);
+    set_mesh(AssetCache::cylinder(0.25f,0.5f,10));
     update_matrix();
 }
 
@@ -88,23 +86,9 @@ void MoveTool::use(std::map<std::string, std::shared_ptr<Event>>& event_buffer,
         held_id_ = 0;
     } else {
         Ray ray = Ray{camera.get_position(), camera.get_direction()};
-        uint32_t nearest = 0;
-        float min_distance = std::numeric_limits<float>::infinity();
-        for (const auto& p : world->get_objects()) {
-            if (p.second.get() == this) {
-                continue;
-            }
-            RayCollision c = GetRayCollisionBox(ray, p.second->get_bounding_box());
-            if (c.hit) {
-                INFO("Hitting object " + p.second->to_string());
-                float d = c.distance;
-                if (d < min_distance) {
-                    nearest = p.first;
-                    min_distance = d;
-                }
-            }
-        }
+        uint32_t nearest = world->raycast(ray, RaycastFilter{OBJECT_MASK_ALL, get_id()}, std::numeric_limits<float>::infinity()).id;
         if (nearest != 0) {
+            INFO("Hitting object " + world->get_objects().at(nearest)->to_string());
             held_id_ = nearest;
             std::shared_ptr<Object3d> held_item = world->get_objects().at(held_id_);
             Vector3 pos = held_item->get_position();
@@ -0,0 +1,123 @@
+#include <assert.h>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+#include "raylib.h"
+
+#include "logging.hpp"
+#include "object/consistent/parameter_tool.hpp"
+#include "player/maincamera.hpp"
+#include "render/asset_cache.hpp"
+#include "util.hpp"
+
+ParameterTool::ParameterTool() : Item(), held_id_(0), part_(0), parameter_(0) {
+    set_color(PURPLE);
+    set_mesh(AssetCache::sphere(0.2f,8,8));
+    update_matrix();
+}
+
+ParameterTool::ParameterTool(std::string data) : Item(), held_id_(0), part_(0), parameter_(0) {
+    std::vector<std::string> split = split_string(data);
+    assert(split[0] == "ParameterTool" && split.size() == 9);
+    position_ = Vector3{std::stof(split[1]), std::stof(split[2]), std::stof(split[3])};
+    scale_ = std::stof(split[4]);
+    quaternion_ = Quaternion{std::stof(split[5]),std::stof(split[6]),std::stof(split[7]),std::stof(split[8])};
+    set_color(PURPLE);
+    set_mesh(AssetCache::sphere(0.2f,8,8));
+    update_matrix();
+}
+
+ParameterTool::ParameterTool(Vector3 position, float scale) : Item(position,scale), held_id_(0), part_(0), parameter_(0) {
+    set_color(PURPLE);
+    set_mesh(AssetCache::sphere(0.2f,8,8));
+    update_matrix();
+}
+
+void ParameterTool::use(std::map<std::string, std::shared_ptr<Event>>& event_buffer, const MainCamera& camera, std::shared_ptr<Player> user, std::shared_ptr<World> world, const std::vector<bool>& keybinds, float dt) {
+    if (keybinds[6]) {
+        held_id_ = 0;
+        held_item_.reset();
+        Ray ray = Ray{camera.get_position(), camera.get_direction()};
+        uint32_t nearest = world->raycast(ray, RaycastFilter{OBJECT_MASK_ALL, get_id()}, std::numeric_limits<float>::infinity()).id;
+        auto procedural = nearest != 0 ? std::dynamic_pointer_cast<ParameterObject>(world->get_objects().at(nearest)) : nullptr;
+        if (procedural == nullptr)
+            return;
+        held_id_ = nearest;
+        held_item_ = procedural;
+        part_ = 0;
+        parameter_ = -1;
+        if (!next_parameter()) {
+            held_id_ = 0;
+            held_item_.reset();
+            return;
+        }
+    }
+    auto held_item = held_item_.lock();
+    if (held_item == nullptr || world->get_objects().find(held_id_) == world->get_objects().end()) {
+        held_id_ = 0;
+        return;
+    }
+    if (keybinds[12])
+        next_parameter();
+    if (!keybinds[7] && !keybinds[8])
+        return;
+
+    ParameterObject* part = held_item->get_part(part_);
+    const ParameterInfo& info = part->get_schema()[parameter_];
+    const float step = (info.initial.max - info.initial.min)/PARAMETER_TOOL_STEPS;
+    const float current = part->get_parameter(info.name).value;
+    const float value = std::clamp(current + (keybinds[7] ? step : -step), info.initial.min, info.initial.max);
+    if (value == current)
+        return;
+    world->update_object(held_id_, part_, info.name, value);
+    if (event_buffer.find("ObjectParameterEvent") != event_buffer.end()) {
+        std::dynamic_pointer_cast<ObjectParameterEvent>(event_buffer["ObjectParameterEvent"])->add(held_id_, part_, std::string(info.name), value);
+    } else {
+        ObjectParameterEvent parameter_event = ObjectParameterEvent({}, user->get_username());
+        parameter_event.add(held_id_, part_, std::string(info.name), value);
+        event_buffer["ObjectParameterEvent"] = std::make_shared<ObjectParameterEvent>(parameter_event);
+    }
+}
+
+bool ParameterTool::next_parameter() {
+    auto held_item = held_item_.lock();
+    if (held_item == nullptr)
+        return false;
+    // Every position is visited at most once before wrapping back to where the walk started
+    const int start_part = part_;
+    const int start_parameter = parameter_;
+    do {
+        parameter_++;
+        ParameterObject* part = held_item->get_part(part_);
+        if (part == nullptr || parameter_ >= (int)part->get_schema().size()) {
+            part_ = held_item->get_part(part_ + 1) != nullptr ? part_ + 1 : 0;
+            parameter_ = -1;
+            continue;
+        }
+        // Colors keep hue, saturation and value in one parameter and have no range to scroll through
+        const ParameterInfo& info = part->get_schema()[parameter_];
+        if (info.initial.min < info.initial.max) {
+            INFO("Editing " + std::string(info.name) + " of part " + std::to_string(part_));
+            return true;
+        }
+    } while (part_ != start_part || parameter_ != start_parameter);
+    return false;
+}
+
+void ParameterTool::prepare_drop(std::map<std::string, std::shared_ptr<Event>>& event_buffer, const MainCamera& camera, std::shared_ptr<Player> user, std::shared_ptr<World> world, const std::vector<bool>& keybinds, float dt) {
+    held_id_ = 0;
+    held_item_.reset();
+}
+
+bool ParameterTool::in_use() const {
+    return held_id_ != 0;
+}
+
+std::string ParameterTool::to_string() const {
+    std::string result = "ParameterTool " +
+        std::to_string(position_.x) + " " + std::to_string(position_.y) + " " + std::to_string(position_.z) + " " +
+        std::to_string(scale_) + " " +
+        std::to_string(quaternion_.x) + " " + std::to_string(quaternion_.y) + " " + std::to_string(quaternion_.z) + " " + std::to_string(quaternion_.w);
+    return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <vector>
+
+#include "raylib.h"
+
+#include "object/object3d.hpp"
+#include "player/maincamera.hpp"
+#include "player/player.hpp"
+#include "world/world.hpp"
+#include "event/event.hpp"
+
+constexpr int PARAMETER_TOOL_STEPS = 20; // scroll steps across a parameter's range
+
+// Edits the parameters of procedural objects. Clicking one selects it, R walks through its parameters and
+// those of its parts and scrolling moves the selected one through its range, rebuilding only what it affects.
+class ParameterTool : public Item {
+public:
+    ParameterTool();
+    ParameterTool(std::string data);
+    ParameterTool(Vector3 position, float scale);
+
+    void use(std::map<std::string, std::shared_ptr<Event>>& event_buffer, const MainCamera& camera, std::shared_ptr<Player> user, std::shared_ptr<World> world, const std::vector<bool>& keybinds, float dt) override;
+
+    void prepare_drop(std::map<std::string, std::shared_ptr<Event>>& event_buffer, const MainCamera& camera, std::shared_ptr<Player> user, std::shared_ptr<World> world, const std::vector<bool>& keybinds, float dt) override;
+
+    bool in_use() const;
+
+    std::string to_string() const override;
+private:
+    // Moves to the next parameter with a range, over every part of the held object, false if it has none
+    bool next_parameter();
+
+    uint32_t held_id_;
+    std::weak_ptr<ParameterObject> held_item_;
+    int part_;
+    int parameter_;
+};
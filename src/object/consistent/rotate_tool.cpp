@@ -10,13 +10,13 @@
 #include "object/consistent/rotate_tool.hpp"
 #include "object/consistent/cube.hpp"
 #include "player/maincamera.hpp"
+#include "render/asset_cache.hpp"
 #include "util.hpp"
 
 RotateTool::RotateTool() : Item(), rotate_speed_(PI/2), axis_{1.0f,0.0f,0.0f} {
     held_id_ = 0;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = BLUE;
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshCube(0.25f,0.25f,0.25f);
+    set_color(BLUE);
+    set_mesh(AssetCache::cube(Vector3{0.25f,0.25f,0.25f}));
     update_matrix();
 }
 
@@ -29,17 +29,15 @@ RotateTool::RotateTool(std::string data) : Item() {
     scale_ = std::stof(split[8]);
     quaternion_ = Quaternion{std::stof(split[9]),std::stof(split[10]),std::stof(split[11]),std::stof(split[12])};
     held_id_ = 0;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = BLUE;
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshCube(0.25f,0.25f,0.25f);
+    set_color(BLUE);
+    set_mesh(AssetCache::cube(Vector3{0.25f,0.25f,0.25f}));
     update_matrix();
 }
 
 RotateTool::RotateTool(Vector3 position, float scale) : Item(position,scale), rotate_speed_(PI/2), axis_{1.0f,0.0f,0.0f} {
     held_id_ = 0;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = BLUE;
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshCube(0.25f,0.25f,0.25f);
+    set_color(BLUE);
+    set_mesh(AssetCache::cube(Vector3{0.25f,0.25f,0.25f}));
     update_matrix();
 }
 
@@ -74,23 +72,9 @@ void RotateTool::use(std::map<std::string, std::shared_ptr<Event>>& event_buffer
     if (!keybinds[6])
         return;
     Ray ray = Ray{camera.get_position(), camera.get_direction()};
-    uint32_t nearest = 0;
-    float min_distance = std::numeric_limits<float>::infinity();
-    for (const auto& p : world->get_objects()) {
-        if (p.second.get() == this) {
-            continue;
-        }
-        RayCollision c = GetRayCollisionBox(ray, p.second->get_bounding_box());
-        if (c.hit) {
-            INFO("Hitting object " + p.second->to_string());
-            float d = c.distance;
-            if (d < min_distance) {
-                nearest = p.first;
-                min_distance = d;
-            }
-        }
-    }
+    uint32_t nearest = world->raycast(ray, RaycastFilter{OBJECT_MASK_ALL, get_id()}, std::numeric_limits<float>::infinity()).id;
     if (nearest != 0) {
+        INFO("Hitting object " + world->get_objects().at(nearest)->to_string());
         held_id_ = nearest;
         held_item_ = world->get_objects().at(held_id_);
         if (keybinds[12]) {
@@ -128,21 +112,13 @@ bool RotateTool::in_use() const {
     return held_id_ != 0;
 }
 
-void RotateTool::draw() const {
-    DrawMesh(mesh_, material_, transform_);
-    if (!in_use()) return;
-    if (auto held_item = held_item_.lock()) {
-        DrawLine3D(held_item->get_position(), Vector3Add(held_item->get_position(),axis_*Vector3Distance(held_item->get_bounding_box().max, held_item->get_bounding_box().min)*2), WHITE);
-    }
+// The axis line goes through rlgl's own batch, which is drawn at the end of the 3D pass
+void RotateTool::submit(InstanceBatcher& batcher, const Matrix& transform) const {
+    Object3d::submit(batcher, transform);
+    draw_axis();
 }
-void RotateTool::draw_offset(float x, float y, float z) const {
-    Matrix offset = MatrixAdd(transform_,Matrix{
-        0,0,0,x,
-        0,0,0,y,
-        0,0,0,z,
-        0,0,0,0
-    });
-    DrawMesh(mesh_, material_, offset);
+
+void RotateTool::draw_axis() const {
     if (!in_use()) return;
     if (auto held_item = held_item_.lock()) {
         DrawLine3D(held_item->get_position(), Vector3Add(held_item->get_position(),axis_*Vector3Distance(held_item->get_bounding_box().max, held_item->get_bounding_box().min)*2), WHITE);
@@ -19,8 +19,9 @@ public:
     RotateTool(Vector3 position, float scale);
 
     void use(std::map<std::string, std::shared_ptr<Event>>& event_buffer, const MainCamera& camera, std::shared_ptr<Player> user, std::shared_ptr<World> world, const std::vector<bool>& keybinds, float dt) override;
-    void draw() const override;
-    void draw_offset(float x, float y, float z) const override;
+    using Object3d::submit;
+    void submit(InstanceBatcher& batcher, const Matrix& transform) const override;
+    bool is_static_batchable() const override {return false;} // draws its axis line too
 
     void prepare_drop(std::map<std::string, std::shared_ptr<Event>>& event_buffer, const MainCamera& camera, std::shared_ptr<Player> user, std::shared_ptr<World> world, const std::vector<bool>& keybinds, float dt) override;
 
@@ -28,6 +29,8 @@ public:
 
     std::string to_string() const override;
 private:
+    void draw_axis() const;
+
     uint32_t held_id_;
     std::weak_ptr<Object3d> held_item_;
 
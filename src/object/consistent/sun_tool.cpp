@@ -8,16 +8,16 @@
 
 #include "object/consistent/cube.hpp"
 #include "player/maincamera.hpp"
+#include "render/asset_cache.hpp"
 #include "util.hpp"
 #include <ctime>
 
 SunTool::SunTool() : Item() {
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshSphere(0.25f,8,8);
+    set_mesh(AssetCache::sphere(0.25f,8,8));
     speed_ = 1.0f;
     color_ = Color{200,200,0,255};
     time_offset_ = 0;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = color_;
+    set_color(color_);
     update_matrix();
 }
 
@@ -27,22 +27,20 @@ SunTool::SunTool(std::string data) : Item() {
     position_ = Vector3{std::stof(split[1]), std::stof(split[2]), std::stof(split[3])};
     time_offset_ = std::stof(split[4]);
     scale_ = std::stof(split[5]);
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshSphere(0.25f,8,8);
+    set_mesh(AssetCache::sphere(0.25f,8,8));
     speed_ = 1.0f;
     color_ = Color{200,200,0,255};
     time_offset_ = 0;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = color_;
+    set_color(color_);
     update_matrix();
 }
 
 SunTool::SunTool(Vector3 position, float scale) : Item(position,scale) {
-    UnloadMesh(mesh_);
-    mesh_ = GenMeshSphere(0.25f,8,8);
+    set_mesh(AssetCache::sphere(0.25f,8,8));
     speed_ = 1.0f;
     color_ = Color{200,200,0,255};
     time_offset_ = 0;
-    material_.maps[MATERIAL_MAP_DIFFUSE].color = color_;
+    set_color(color_);
     update_matrix();
 }
 
@@ -1,36 +1,33 @@
-#define MAX_MATERIAL_MAPS 12
+#include <algorithm>
 
 #include "object/object3d.hpp"
+#include "render/asset_cache.hpp"
+#include "render/instance_batcher.hpp"
+#include "world/bvh.hpp"
+#include "world/transform_store.hpp"
 #include "rlgl.h"
 #include "raymath.h"
 
-Object3d::Object3d() : mesh_(GenMeshCube(1.0f, 1.0f, 1.0f)), material_(std::move(LoadMaterialDefault())), position_{0.0f,0.0f,0.0f}, scale_(1.0f), quaternion_{0.0f,0.0f,0.0f,1.0f} {};
-Object3d::Object3d(float scale) : mesh_(GenMeshCube(1.0f, 1.0f, 1.0f)), material_(std::move(LoadMaterialDefault())), position_{0.0f,0.0f,0.0f}, scale_(scale), quaternion_{0.0f,0.0f,0.0f,1.0f} {};
-Object3d::Object3d(Vector3 position, float scale) : mesh_(GenMeshCube(1.0f, 1.0f, 1.0f)), material_(std::move(LoadMaterialDefault())), position_(position), scale_(scale), quaternion_{0.0f,0.0f,0.0f,1.0f} {};
-Object3d::Object3d(Quaternion quaternion, Vector3 position, float scale) : mesh_(GenMeshCube(1.0f, 1.0f, 1.0f)), material_(std::move(LoadMaterialDefault())), position_(position), scale_(scale), quaternion_{quaternion} {};
-Object3d::~Object3d() {
-    UnloadMesh(mesh_);
-    if (material_.maps != NULL){
-        for (int i = 0; i < MAX_MATERIAL_MAPS; i++)
-            if (material_.maps[i].texture.id != rlGetTextureIdDefault()) rlUnloadTexture(material_.maps[i].texture.id);
-    }
-    RL_FREE(material_.maps);
+Object3d::Object3d() : quaternion_{0.0f,0.0f,0.0f,1.0f}, position_{0.0f,0.0f,0.0f}, material_(AssetCache::material(WHITE)), scale_(1.0f) {
+    update_local_bounds();
 }
-
-void Object3d::draw() const {
-    DrawMesh(mesh_, material_, transform_);
+Object3d::Object3d(float scale) : quaternion_{0.0f,0.0f,0.0f,1.0f}, position_{0.0f,0.0f,0.0f}, material_(AssetCache::material(WHITE)), scale_(scale) {
+    update_local_bounds();
+}
+Object3d::Object3d(Vector3 position, float scale) : quaternion_{0.0f,0.0f,0.0f,1.0f}, position_(position), material_(AssetCache::material(WHITE)), scale_(scale) {
+    update_local_bounds();
 }
-void Object3d::draw(Matrix transform) const {
-    DrawMesh(mesh_, material_, transform);
+Object3d::Object3d(Quaternion quaternion, Vector3 position, float scale) : quaternion_{quaternion}, position_(position), material_(AssetCache::material(WHITE)), scale_(scale) {
+    update_local_bounds();
+}
+Object3d::~Object3d() {}
+
+void Object3d::submit(InstanceBatcher& batcher) const {
+    submit(batcher, transform_);
 }
-void Object3d::draw_offset(float x, float y, float z) const {
-    Matrix offset = MatrixAdd(transform_,Matrix{
-        0,0,0,x,
-        0,0,0,y,
-        0,0,0,z,
-        0,0,0,0
-    });
-    DrawMesh(mesh_, material_, offset);
+void Object3d::submit(InstanceBatcher& batcher, const Matrix& transform) const {
+    if (mesh_ != nullptr)
+        batcher.add_draw(*mesh_, *material_, transform);
 }
 
 std::shared_ptr<Shader> Object3d::get_shader() {
@@ -39,12 +36,18 @@ std::shared_ptr<Shader> Object3d::get_shader() {
 
 void Object3d::set_shader(std::shared_ptr<Shader> shader) {
     shader_ = shader;
-    material_.shader = *shader;
+    material_ = AssetCache::material(material_->maps[MATERIAL_MAP_DIFFUSE].color, *shader);
+    revision_++;
+}
+
+void Object3d::set_color(Color color) {
+    material_ = AssetCache::material(color, material_->shader);
+    revision_++;
 }
 
 void Object3d::set_quaternion(Quaternion quaternion) {
     quaternion_ = quaternion;
-    update_matrix();
+    transform_changed();
 }
 
 Quaternion Object3d::get_quaternion() {
@@ -54,11 +57,43 @@ Quaternion Object3d::get_quaternion() {
 void Object3d::rotate_axis(Vector3 axis, float radians) {
     Quaternion rotation = QuaternionFromAxisAngle(axis,radians);
     quaternion_ = QuaternionMultiply(rotation,quaternion_);
-    update_matrix();
+    transform_changed();
 }
 
 void Object3d::update_matrix() {
     transform_ = MatrixMultiply(MatrixScale(scale_, scale_, scale_),MatrixMultiply(QuaternionToMatrix(quaternion_), MatrixTranslate(position_.x, position_.y, position_.z)));
+    bounds_dirty_ = true;
+    revision_++;
+    matrix_changed();
+}
+
+void Object3d::set_matrix(const Matrix& transform) {
+    transform_ = transform;
+    bounds_dirty_ = true;
+    revision_++;
+    matrix_changed();
+}
+
+void Object3d::set_transform_node(TransformStore* store, int32_t node) {
+    transform_store_ = store;
+    transform_node_ = node;
+    transform_node_changed();
+}
+
+// Outside a World the matrix is composed right away, inside one the store batches it
+void Object3d::transform_changed() {
+    if (transform_store_ != nullptr) {
+        transform_store_->mark(transform_node_);
+        return;
+    }
+    update_matrix();
+    refit_bvh();
+}
+
+// Keeps this object's leaf in the world's BVH in sync after a transform change
+void Object3d::refit_bvh() {
+    if (bvh_ != nullptr)
+        bvh_->move(bvh_proxy_, get_bounding_box());
 }
 
 const Matrix& Object3d::get_matrix() const {
@@ -67,7 +102,7 @@ const Matrix& Object3d::get_matrix() const {
 
 void Object3d::set_position(Vector3 position) {
     position_ = position;
-    update_matrix();
+    transform_changed();
 }
 
 Vector3 Object3d::get_position() const {
@@ -76,7 +111,7 @@ Vector3 Object3d::get_position() const {
 
 void Object3d::set_scale(float scale) {
     scale_ = scale;
-    update_matrix();
+    transform_changed();
 }
 
 float Object3d::get_scale() const {
@@ -84,51 +119,73 @@ float Object3d::get_scale() const {
 }
 
 BoundingBox Object3d::get_bounding_box() const {
-    Vector3 minVertex = { 0 };
-    Vector3 maxVertex = { 0 };
-
-    if (mesh_.vertices != NULL)
-    {
-        minVertex = Vector3Transform(Vector3{ mesh_.vertices[0], mesh_.vertices[1], mesh_.vertices[2]},transform_);
-        maxVertex = Vector3Transform(Vector3{ mesh_.vertices[0], mesh_.vertices[1], mesh_.vertices[2]},transform_);
-
-        for (int i = 1; i < mesh_.vertexCount; i++)
-        {
-            minVertex = Vector3Min(minVertex, Vector3Transform(Vector3{mesh_.vertices[i*3], mesh_.vertices[i*3 + 1], mesh_.vertices[i*3 + 2] },transform_));
-            maxVertex = Vector3Max(maxVertex, Vector3Transform(Vector3{mesh_.vertices[i*3], mesh_.vertices[i*3 + 1], mesh_.vertices[i*3 + 2] },transform_));
-        }
+    if (bounds_dirty_) {
+        world_bounds_ = transform_bounding_box(local_bounds_, transform_);
+        bounds_dirty_ = false;
     }
+    return world_bounds_;
+}
 
-    // Create the bounding box
-    BoundingBox box = { 0 };
-    box.min = minVertex;
-    box.max = maxVertex;
+BoundingBox Object3d::get_bounding_box(Matrix transform) const {
+    return transform_bounding_box(local_bounds_, transform);
+}
 
-    return box;
+const BoundingBox& Object3d::get_local_bounding_box() const {
+    return local_bounds_;
 }
 
-BoundingBox Object3d::get_bounding_box(Matrix transform) const {
-    Vector3 minVertex = { 0 };
-    Vector3 maxVertex = { 0 };
-
-    if (mesh_.vertices != NULL)
-    {
-        minVertex = Vector3Transform(Vector3{ mesh_.vertices[0], mesh_.vertices[1], mesh_.vertices[2]},transform);
-        maxVertex = Vector3Transform(Vector3{ mesh_.vertices[0], mesh_.vertices[1], mesh_.vertices[2]},transform);
-
-        for (int i = 1; i < mesh_.vertexCount; i++)
-        {
-            minVertex = Vector3Min(minVertex, Vector3Transform(Vector3{mesh_.vertices[i*3], mesh_.vertices[i*3 + 1], mesh_.vertices[i*3 + 2] },transform));
-            maxVertex = Vector3Max(maxVertex, Vector3Transform(Vector3{mesh_.vertices[i*3], mesh_.vertices[i*3 + 1], mesh_.vertices[i*3 + 2] },transform));
-        }
-    }
+const std::shared_ptr<const Mesh>& Object3d::get_mesh() const {
+    return mesh_;
+}
 
-    // Create the bounding box
-    BoundingBox box = { 0 };
-    box.min = minVertex;
-    box.max = maxVertex;
+const std::shared_ptr<Material>& Object3d::get_material() const {
+    return material_;
+}
+
+void Object3d::set_mesh(std::shared_ptr<const Mesh> mesh) {
+    mesh_ = std::move(mesh);
+    revision_++;
+    update_local_bounds();
+}
 
-    return box;
+void Object3d::update_local_bounds() {
+    Vector3 min_vertex = { 0 };
+    Vector3 max_vertex = { 0 };
+    if (mesh_ != nullptr && mesh_->vertices != NULL && mesh_->vertexCount > 0) {
+        min_vertex = Vector3{mesh_->vertices[0], mesh_->vertices[1], mesh_->vertices[2]};
+        max_vertex = min_vertex;
+        for (int i = 1; i < mesh_->vertexCount; i++) {
+            Vector3 vertex = {mesh_->vertices[i*3], mesh_->vertices[i*3 + 1], mesh_->vertices[i*3 + 2]};
+            min_vertex = Vector3Min(min_vertex, vertex);
+            max_vertex = Vector3Max(max_vertex, vertex);
+        }
+    }
+    local_bounds_ = BoundingBox{min_vertex, max_vertex};
+    bounds_dirty_ = true;
+}
+
+BoundingBox transform_bounding_box(const BoundingBox& box, const Matrix& transform) {
+    // Each output axis starts at the translation and accumulates the smaller/larger product per input axis
+    const float rows[3][4] = {
+        {transform.m0, transform.m4, transform.m8, transform.m12},
+        {transform.m1, transform.m5, transform.m9, transform.m13},
+        {transform.m2, transform.m6, transform.m10, transform.m14}
+    };
+    const float min_in[3] = {box.min.x, box.min.y, box.min.z};
+    const float max_in[3] = {box.max.x, box.max.y, box.max.z};
+    float min_out[3];
+    float max_out[3];
+    for (int i = 0; i < 3; i++) {
+        min_out[i] = rows[i][3];
+        max_out[i] = rows[i][3];
+        for (int j = 0; j < 3; j++) {
+            float a = rows[i][j]*min_in[j];
+            float b = rows[i][j]*max_in[j];
+            min_out[i] += std::min(a,b);
+            max_out[i] += std::max(a,b);
+        }
+    }
+    return BoundingBox{Vector3{min_out[0], min_out[1], min_out[2]}, Vector3{max_out[0], max_out[1], max_out[2]}};
 }
 
 Item::Item() : Object3d() {}
@@ -143,10 +200,15 @@ ParameterObject::ParameterObject(Quaternion quaternion, Vector3 position, float
 
 void ParameterObject::set_parameters(ParameterMap map) {
     parameter_map_ = map;
+    changed_effects_ = PARAMETER_EFFECT_ALL;
 }
-void ParameterObject::set_parameter(std::string name, float value) {
-    parameter_map_.set_parameter(name,value);
+void ParameterObject::set_parameter(std::string_view name, float value) {
+    int index = parameter_map_.find(name);
+    if (index == -1)
+        return;
+    parameter_map_[index].value = value;
+    changed_effects_ |= parameter_map_.get_schema()[index].effect;
 }
-const Parameter ParameterObject::get_parameter(std::string name) const {
+Parameter ParameterObject::get_parameter(std::string_view name) const {
     return parameter_map_.get_parameter(name);
 }
\ No newline at end of file
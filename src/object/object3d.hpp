@@ -1,18 +1,26 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <map>
 #include <memory>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "raylib.h"
 
 #include "object/procedural/parameter.hpp"
 
+class Bvh;
+class TransformStore;
 class Player;
 class World;
 class MainCamera;
 class Event;
+class InstanceBatcher;
+
+// Bounds of box under transform, derived from the box extents (Arvo) instead of its 8 corners
+BoundingBox transform_bounding_box(const BoundingBox& box, const Matrix& transform);
 
 class Object3d {
 public:
@@ -24,18 +32,31 @@ public:
 
     void set_id(uint32_t id) {id_ = id;}
     uint32_t get_id() const {return id_;}
-
-    virtual void draw() const;
-    virtual void draw(Matrix transform) const;
-    virtual void draw_offset(float x, float y, float z) const;
+    void set_bvh_proxy(Bvh* bvh, int32_t proxy) {bvh_ = bvh; bvh_proxy_ = proxy;}
+    int32_t get_bvh_proxy() const {return bvh_proxy_;}
+    void set_transform_node(TransformStore* store, int32_t node);
+    int32_t get_transform_node() const {return transform_node_;}
+    // Bumped by every change to the object's matrix, mesh or material, so caches built from them can tell
+    // they went stale
+    uint32_t get_revision() const {return revision_;}
+
+    virtual void submit(InstanceBatcher& batcher) const;
+    virtual void submit(InstanceBatcher& batcher, const Matrix& transform) const; // with transform in place of the object's own
+    // Whether drawing the mesh with the material at the matrix is all submit does, so the object can be
+    // merged into a static batch while it stays put
+    virtual bool is_static_batchable() const {return mesh_ != nullptr;}
     virtual void set_shader(std::shared_ptr<Shader> shader);
     virtual std::shared_ptr<Shader> get_shader();
+    void set_color(Color color);
 
     virtual void set_quaternion(Quaternion quaternion);
     virtual Quaternion get_quaternion();
     virtual void rotate_axis(Vector3 axis, float radians);
 
     virtual void update_matrix();
+    // Installs a matrix composed elsewhere from this object's position, rotation and scale. The BVH leaf is
+    // left to the caller, which refits a batch of them at once.
+    void set_matrix(const Matrix& transform);
     virtual const Matrix& get_matrix() const;
 
     virtual void set_position(Vector3 position);
@@ -46,18 +67,42 @@ public:
 
     virtual BoundingBox get_bounding_box() const;
     virtual BoundingBox get_bounding_box(Matrix transform) const;
+    const BoundingBox& get_local_bounding_box() const;
+    const std::shared_ptr<const Mesh>& get_mesh() const;
+    const std::shared_ptr<Material>& get_material() const;
 
     virtual std::string to_string() const = 0;
 protected:
+    // Follows every change of transform_, for subclasses with state derived from it
+    virtual void matrix_changed() {}
+    // Follows joining or leaving a World's TransformStore, for subclasses with nodes of their own under it
+    virtual void transform_node_changed() {}
+    TransformStore* get_transform_store() const {return transform_store_;}
+    void refit_bvh();
+    void set_mesh(std::shared_ptr<const Mesh> mesh);
+    void update_local_bounds();
+
     std::shared_ptr<Shader> shader_;
     Quaternion quaternion_;
     Vector3 position_;
-    Mesh mesh_;
-    Material material_;
+    std::shared_ptr<const Mesh> mesh_; // null until a subclass sets or generates one
+    std::shared_ptr<Material> material_; // shared through AssetCache, swap it instead of editing in place
     float scale_;
     Matrix transform_;
+    BoundingBox local_bounds_; // mesh bounds in object space, recomputed only when the mesh changes
+    mutable BoundingBox world_bounds_;
+    mutable bool bounds_dirty_ = true; // set by update_matrix, world_bounds_ is rebuilt lazily
 private:
     uint32_t id_ = 0;
+    Bvh* bvh_ = nullptr;
+    int32_t bvh_proxy_ = -1;
+    // Objects in a World leave composing their matrix to its TransformStore, which updates once per frame
+    TransformStore* transform_store_ = nullptr;
+    int32_t transform_node_ = -1;
+    uint32_t revision_ = 0;
+
+    void transform_changed();
+    friend class TransformStore; // gathers position, rotation and scale straight from here
 };
 
 class Item : public Object3d {
@@ -79,14 +124,28 @@ public:
     ParameterObject(Quaternion quaternion, Vector3 position, float scale);
 
     virtual void generate_mesh() = 0;
+    // CPU half of generate_mesh, safe on a worker thread for an object no other thread uses yet. Stages the
+    // mesh data so the generate_mesh that follows on the main thread only has to upload it.
+    void prepare_mesh() {if (std::function<void()> job = mesh_job()) job();}
+    // prepare_mesh for objects the main thread keeps editing. Called there, it copies what the mesh is built
+    // from and returns the build for a worker, which never touches the object. Empty if nothing needs building.
+    virtual std::function<void()> mesh_job() {return {};}
+    // Applies parameters set since the last generate, redoing only the parts their effect tags name
+    virtual void update_mesh() {generate_mesh();}
     
     void set_parameters(ParameterMap map);
-    void set_parameter(std::string name, float value);
-    const Parameter get_parameter(std::string name) const;
+    void set_parameter(std::string_view name, float value);
+    Parameter get_parameter(std::string_view name) const;
+    ParameterSchema get_schema() const {return parameter_map_.get_schema();}
+    uint32_t get_changed_effects() const {return changed_effects_;}
+    // Parameter sets edited on their own, 0 is this object and sub-objects follow. null past the last one.
+    // Edits to any part are applied by this object's update_mesh.
+    virtual ParameterObject* get_part(int part) {return part == 0 ? this : nullptr;}
 
     virtual ~ParameterObject() {};
 protected:
     virtual void initialize_parameters() = 0;
 
     ParameterMap parameter_map_; 
+    uint32_t changed_effects_ = PARAMETER_EFFECT_NONE; // union of effects set since the last generate
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <cassert>
 
 #include "object/procedural/lily_flower.hpp"
+#include "render/instance_batcher.hpp"
 #include "util.hpp"
 
 #include "raymath.h"
@@ -39,41 +40,38 @@ LilyFlower::LilyFlower(std::string data) : ParameterObject() {
     scale_ = std::stof(split[4]);
     quaternion_ = Quaternion{std::stof(split[5]),std::stof(split[6]),std::stof(split[7]),std::stof(split[8])};
     seed_ = std::stoull(split[9]);
-    parameter_map_ = ParameterMap(split[10]);
+    parameter_map_ = ParameterMap(LILY_SCHEMA, split[10]);
     upper_petal_ = std::make_unique<TaperedPetal>(split[11]);
     lower_petal_ = std::make_unique<TaperedPetal>(split[12]);
 }
 
-void LilyFlower::draw() const {
-    upper_petal_->draw(upper_transforms_[0]);
-    upper_petal_->draw(upper_transforms_[1]);
-    upper_petal_->draw(upper_transforms_[2]);
-    lower_petal_->draw(lower_transforms_[0]);
-    lower_petal_->draw(lower_transforms_[1]);
-    lower_petal_->draw(lower_transforms_[2]);
+void LilyFlower::submit(InstanceBatcher& batcher) const {
+    lod_level_ = select_lod(screen_size(batcher.get_view(), get_bounding_box()), lod_level_);
+    const std::shared_ptr<const Mesh>& upper = upper_petal_->get_lod_mesh(lod_level_);
+    const std::shared_ptr<const Mesh>& lower = lower_petal_->get_lod_mesh(lod_level_);
+    for (int i = 0; i < 3; i++) {
+        batcher.add(upper, get_petal_matrix(i), !upper_petal_->is_single_sided());
+        batcher.add(lower, get_petal_matrix(i + 3), !lower_petal_->is_single_sided());
+    }
 }
-void LilyFlower::draw(Matrix transform) const {
-    upper_petal_->draw(MatrixMultiply(upper_transforms_[0], transform));
-    upper_petal_->draw(MatrixMultiply(upper_transforms_[1], transform));
-    upper_petal_->draw(MatrixMultiply(upper_transforms_[2], transform));
-    lower_petal_->draw(MatrixMultiply(lower_transforms_[0], transform));
-    lower_petal_->draw(MatrixMultiply(lower_transforms_[1], transform));
-    lower_petal_->draw(MatrixMultiply(lower_transforms_[2], transform));
-}
-void LilyFlower::draw_offset(float x, float y, float z) const {
-    Matrix offset = MatrixTranslate(x,y,z);
-    draw(offset);
+void LilyFlower::submit(InstanceBatcher& batcher, const Matrix& transform) const {
+    for (int i = 0; i < 3; i++) {
+        upper_petal_->submit(batcher, MatrixMultiply(petal_locals_[i], transform));
+        lower_petal_->submit(batcher, MatrixMultiply(petal_locals_[i + 3], transform));
+    }
 }
 void LilyFlower::set_shader(std::shared_ptr<Shader> shader) {
     upper_petal_->set_shader(shader);
     lower_petal_->set_shader(shader);
 }
 
-void LilyFlower::update_matrix() {
+// Petal placement relative to the flower, depends on the pitches and both petals' shapes but not on the
+// flower's own transform
+void LilyFlower::update_local_transforms() {
     const float SQRT_3 = std::sqrtf(3.0f);
 
-    float pitch_upper = parameter_map_.get_parameter("PetalPitchUpper").value*DEG2RAD;
-    float pitch_lower = parameter_map_.get_parameter("PetalPitchLower").value*DEG2RAD;
+    float pitch_upper = parameter_map_[LilyParameter::PETAL_PITCH_UPPER].value*DEG2RAD;
+    float pitch_lower = parameter_map_[LilyParameter::PETAL_PITCH_LOWER].value*DEG2RAD;
     
     float default_angle_upper = std::acos(Vector3DotProduct(Vector3Normalize(upper_petal_->tip_vector()), Vector3{1,0,0}));
     float default_angle_lower = std::acos(Vector3DotProduct(Vector3Normalize(lower_petal_->tip_vector()), Vector3{1,0,0}));
@@ -97,51 +95,117 @@ void LilyFlower::update_matrix() {
     Quaternion splay_four = QuaternionFromAxisAngle(Vector3{0,1,0},PI);
     Quaternion splay_five = QuaternionFromAxisAngle(Vector3{0,1,0},5*PI/3);
 
-    Matrix inner_transform_upper = MatrixMultiply(QuaternionToMatrix(pitch_quaternion_upper),MatrixTranslate(offset_upper,0,0));
-    Matrix inner_transform_upper_one = MatrixMultiply(QuaternionToMatrix(pitch_quaternion_upper),MatrixMultiply(MatrixTranslate(offset_upper,0,0),QuaternionToMatrix(splay_one)));
-    Matrix inner_transform_upper_two = MatrixMultiply(QuaternionToMatrix(pitch_quaternion_upper),MatrixMultiply(MatrixTranslate(offset_upper,0,0),QuaternionToMatrix(splay_two)));
-    Matrix inner_transform_lower = MatrixMultiply(QuaternionToMatrix(pitch_quaternion_lower),MatrixMultiply(MatrixTranslate(offset_lower,0,0),QuaternionToMatrix(splay_three)));
-    Matrix inner_transform_lower_one = MatrixMultiply(QuaternionToMatrix(pitch_quaternion_lower),MatrixMultiply(MatrixTranslate(offset_lower,0,0),QuaternionToMatrix(splay_four)));
-    Matrix inner_transform_lower_two = MatrixMultiply(QuaternionToMatrix(pitch_quaternion_lower),MatrixMultiply(MatrixTranslate(offset_lower,0,0),QuaternionToMatrix(splay_five)));
-
-    transform_ = MatrixMultiply(MatrixScale(scale_, scale_, scale_),MatrixMultiply(QuaternionToMatrix(quaternion_), MatrixTranslate(position_.x, position_.y, position_.z)));
-    
-    upper_transforms_[0] = MatrixMultiply(inner_transform_upper, transform_);
-    upper_transforms_[1] = MatrixMultiply(inner_transform_upper_one, transform_);
-    upper_transforms_[2] = MatrixMultiply(inner_transform_upper_two, transform_);
-
-    lower_transforms_[0] = MatrixMultiply(inner_transform_lower, transform_);
-    lower_transforms_[1] = MatrixMultiply(inner_transform_lower_one, transform_);
-    lower_transforms_[2] = MatrixMultiply(inner_transform_lower_two, transform_);
+    const std::array<Matrix,6> locals = {
+        MatrixMultiply(QuaternionToMatrix(pitch_quaternion_upper),MatrixTranslate(offset_upper,0,0)),
+        MatrixMultiply(QuaternionToMatrix(pitch_quaternion_upper),MatrixMultiply(MatrixTranslate(offset_upper,0,0),QuaternionToMatrix(splay_one))),
+        MatrixMultiply(QuaternionToMatrix(pitch_quaternion_upper),MatrixMultiply(MatrixTranslate(offset_upper,0,0),QuaternionToMatrix(splay_two))),
+        MatrixMultiply(QuaternionToMatrix(pitch_quaternion_lower),MatrixMultiply(MatrixTranslate(offset_lower,0,0),QuaternionToMatrix(splay_three))),
+        MatrixMultiply(QuaternionToMatrix(pitch_quaternion_lower),MatrixMultiply(MatrixTranslate(offset_lower,0,0),QuaternionToMatrix(splay_four))),
+        MatrixMultiply(QuaternionToMatrix(pitch_quaternion_lower),MatrixMultiply(MatrixTranslate(offset_lower,0,0),QuaternionToMatrix(splay_five)))
+    };
+
+    // Local bounds are the union of the six placed petals
+    const BoundingBox& upper_bounds = upper_petal_->get_local_bounding_box();
+    const BoundingBox& lower_bounds = lower_petal_->get_local_bounding_box();
+    std::array<BoundingBox,6> petal_bounds = {
+        transform_bounding_box(upper_bounds, locals[0]),
+        transform_bounding_box(upper_bounds, locals[1]),
+        transform_bounding_box(upper_bounds, locals[2]),
+        transform_bounding_box(lower_bounds, locals[3]),
+        transform_bounding_box(lower_bounds, locals[4]),
+        transform_bounding_box(lower_bounds, locals[5])
+    };
+    local_bounds_ = petal_bounds[0];
+    for (const BoundingBox& box : petal_bounds) {
+        local_bounds_.min = Vector3Min(local_bounds_.min, box.min);
+        local_bounds_.max = Vector3Max(local_bounds_.max, box.max);
+    }
+    petal_locals_ = locals;
+    if (TransformStore* store = get_transform_store()) {
+        for (int i = 0; i < 6; i++)
+            store->set_local(petal_nodes_[i], petal_locals_[i]);
+    }
+    locals_dirty_ = false;
+}
+
+// Removing the flower's node took the petals' with it
+void LilyFlower::transform_node_changed() {
+    TransformStore* store = get_transform_store();
+    for (int i = 0; i < 6; i++)
+        petal_nodes_[i] = store != nullptr ? store->add(get_transform_node(), petal_locals_[i]) : TRANSFORM_NONE;
+}
+
+// Outside a World the petal follows the flower here instead of in the store
+Matrix LilyFlower::get_petal_matrix(int petal) const {
+    if (TransformStore* store = get_transform_store())
+        return store->get_world(petal_nodes_[petal]);
+    return MatrixMultiply(petal_locals_[petal], transform_);
+}
+
+// Runs on every move, so unless the petals changed the petals just follow the flower
+void LilyFlower::matrix_changed() {
+    // Pitches and petal shapes set without an update_mesh yet still apply right away, colors and freckles
+    // do not move anything
+    const uint32_t PLACEMENT = PARAMETER_EFFECT_GEOMETRY | PARAMETER_EFFECT_TRANSFORM;
+    if (locals_dirty_ || (changed_effects_ & PLACEMENT) ||
+        (upper_petal_->get_changed_effects() & PLACEMENT) || (lower_petal_->get_changed_effects() & PLACEMENT))
+        update_local_transforms();
 }
 
-BoundingBox LilyFlower::get_bounding_box() const {
-    BoundingBox upper = upper_petal_->get_bounding_box(transform_);
-    BoundingBox lower = lower_petal_->get_bounding_box(transform_);
-    return BoundingBox{Vector3{std::max(upper.max.x,lower.max.x),std::max(upper.max.y,lower.max.y),std::max(upper.max.z,lower.max.z)},
-                       Vector3{std::min(upper.min.x,lower.min.x),std::min(upper.min.y,lower.min.y),std::min(upper.min.z,lower.min.z)}};
-}
 BoundingBox LilyFlower::get_bounding_box(Matrix transform) const {
-    Matrix m = MatrixMultiply(transform_, transform);
-    BoundingBox upper = upper_petal_->get_bounding_box(m);
-    BoundingBox lower = lower_petal_->get_bounding_box(m);
-    return BoundingBox{Vector3{std::max(upper.max.x,lower.max.x),std::max(upper.max.y,lower.max.y),std::max(upper.max.z,lower.max.z)},
-                       Vector3{std::min(upper.min.x,lower.min.x),std::min(upper.min.y,lower.min.y),std::min(upper.min.z,lower.min.z)}};
+    return transform_bounding_box(local_bounds_, MatrixMultiply(transform_, transform));
 }
 
+std::function<void()> LilyFlower::mesh_job() {
+    std::function<void()> upper = upper_petal_->mesh_job();
+    std::function<void()> lower = lower_petal_->mesh_job();
+    if (!upper && !lower)
+        return {};
+    return [upper, lower]() {
+        if (upper) upper();
+        if (lower) lower();
+    };
+}
 void LilyFlower::generate_mesh() {
+    changed_effects_ = PARAMETER_EFFECT_NONE;
+    locals_dirty_ = true;
     upper_petal_->generate_mesh();
     lower_petal_->generate_mesh();
     update_matrix();
+    refit_bvh();
 }
 void LilyFlower::generate_mesh(uint64_t seed) {
+    changed_effects_ = PARAMETER_EFFECT_NONE;
+    locals_dirty_ = true;
     upper_petal_->generate_mesh(seed);
     lower_petal_->generate_mesh(seed);
     update_matrix();
+    refit_bvh();
+}
+// The pitches only move the petals, so without petal changes this is just the sub-transforms
+void LilyFlower::update_mesh() {
+    if (changed_effects_ == PARAMETER_EFFECT_NONE && upper_petal_->get_changed_effects() == PARAMETER_EFFECT_NONE &&
+        lower_petal_->get_changed_effects() == PARAMETER_EFFECT_NONE)
+        return;
+    changed_effects_ = PARAMETER_EFFECT_NONE;
+    locals_dirty_ = true;
+    upper_petal_->update_mesh();
+    lower_petal_->update_mesh();
+    update_matrix();
+    refit_bvh();
+}
+ParameterObject* LilyFlower::get_part(int part) {
+    switch (part) {
+    case 0: return this;
+    case 1: return upper_petal_.get();
+    case 2: return lower_petal_.get();
+    default: return nullptr;
+    }
 }
 void LilyFlower::set_slices(std::pair<int,int> slices) {
     upper_petal_->set_slices(slices);
     lower_petal_->set_slices(slices);
+    locals_dirty_ = true;
 }
 std::string LilyFlower::to_string() const {
     return "LilyFlower " +
@@ -154,6 +218,5 @@ std::string LilyFlower::to_string() const {
         lower_petal_->to_string() + ")";
 }
 void LilyFlower::initialize_parameters() {
-    parameter_map_.set_parameter("PetalPitchUpper", Parameter{-90.0f,35.0f,80.0f});
-    parameter_map_.set_parameter("PetalPitchLower", Parameter{-90.0f,35.0f,80.0f});
+    parameter_map_ = ParameterMap(LILY_SCHEMA);
 }
\ No newline at end of file
@@ -5,9 +5,22 @@
 #include "object/object3d.hpp"
 #include "object/procedural/tapered_petal.hpp"
 #include "object/procedural/parameter.hpp"
+#include "world/transform_store.hpp"
 
 #include "raylib.h"
 
+enum class LilyParameter {
+    PETAL_PITCH_UPPER,
+    PETAL_PITCH_LOWER,
+    COUNT
+};
+
+inline constexpr std::array<ParameterInfo, (size_t)LilyParameter::COUNT> LILY_SCHEMA = {{
+    {"PetalPitchUpper", {-90.0f,35.0f,80.0f}, PARAMETER_EFFECT_TRANSFORM},
+    {"PetalPitchLower", {-90.0f,35.0f,80.0f}, PARAMETER_EFFECT_TRANSFORM}
+}};
+static_assert(LILY_SCHEMA.size() <= MAX_PARAMETERS);
+
 class LilyFlower : public ParameterObject {
 public:
     LilyFlower();
@@ -16,30 +29,42 @@ public:
     LilyFlower(ParameterMap map, uint64_t seed, Quaternion quaternion, Vector3 position, float scale);
     LilyFlower(std::string data);
 
-    void draw() const override;
-    void draw(Matrix transform) const override;
-    void draw_offset(float x, float y, float z) const override;
+    void submit(InstanceBatcher& batcher) const override;
+    void submit(InstanceBatcher& batcher, const Matrix& transform) const override;
+    bool is_static_batchable() const override {return false;}
     void set_shader(std::shared_ptr<Shader> shader) override;
 
-    void update_matrix() override;
-
-    BoundingBox get_bounding_box() const override;
+    using Object3d::get_bounding_box;
     BoundingBox get_bounding_box(Matrix transform) const override;
 
+    std::function<void()> mesh_job() override;
     void generate_mesh() override;
     void generate_mesh(uint64_t seed);
+    void update_mesh() override;
+    // Petal parameters are set on the petals themselves, update_mesh picks their changes up too
+    TaperedPetal& get_upper_petal() {return *upper_petal_;}
+    TaperedPetal& get_lower_petal() {return *lower_petal_;}
+    ParameterObject* get_part(int part) override; // 1 is the upper petal, 2 the lower
     void set_slices(std::pair<int,int> slices);
 
     std::string to_string() const override;
 private:
     void initialize_parameters() override;
+    void matrix_changed() override;
+    void transform_node_changed() override;
+    void update_local_transforms();
+    Matrix get_petal_matrix(int petal) const;
 
     std::unique_ptr<TaperedPetal> upper_petal_;
     std::unique_ptr<TaperedPetal> lower_petal_;
 
-    std::array<Matrix,3> upper_transforms_;
-    std::array<Matrix,3> lower_transforms_;
+    // Petal placement in flower space, upper petals first, only set again when the petals change. In a World
+    // every petal has a node under the flower's and the store keeps its world matrix.
+    std::array<Matrix,6> petal_locals_ {};
+    std::array<int32_t,6> petal_nodes_ = {TRANSFORM_NONE, TRANSFORM_NONE, TRANSFORM_NONE, TRANSFORM_NONE, TRANSFORM_NONE, TRANSFORM_NONE};
+    bool locals_dirty_ = true;
 
     std::pair<int,int> slices_;
     uint64_t seed_;
+    mutable int lod_level_ = 0;
 };
\ No newline at end of file
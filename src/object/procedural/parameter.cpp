@@ -6,9 +6,6 @@
 #include "object/procedural/parameter.hpp"
 #include "util.hpp"
 
-Parameter::Parameter() : min(0), value(0), max(0) {}
-Parameter::Parameter(float min, float value, float max) : min(min), value(value), max(max) {}
-
 void Parameter::seed_gaussian(std::mt19937_64& rng) {
     std::normal_distribution dist((max+min)/2.0f,(max-min)/6.0f);
     value = std::clamp<float>(dist(rng),min,max);
@@ -32,52 +29,88 @@ void Parameter::seed_hsv_uniform(float hue_min, float hue_max, std::mt19937_64&
     max = std::clamp<float>(dist_sv(rng),0.0f,1.0f);
 }
 
-ParameterMap::ParameterMap() : parameters_{} {}
-ParameterMap::ParameterMap(std::string data) {
+ParameterMap::ParameterMap() : schema_{}, parameters_{} {}
+ParameterMap::ParameterMap(ParameterSchema schema) : schema_(schema), parameters_{} {
+    assert(schema.size() <= MAX_PARAMETERS);
+    for (size_t i = 0; i < schema.size(); i++)
+        parameters_[i] = schema[i].initial;
+}
+ParameterMap::ParameterMap(ParameterSchema schema, const std::string& data) : ParameterMap(schema) {
     std::vector<std::string> split = split_string(data);
     assert(split[0] == "ParameterMap");
     std::vector<std::string> parameter_split = split_string(split[1]);
     for (std::string s : parameter_split) {
         std::vector<std::string> a = split_string(s);
-        Parameter p {std::stof(a[1]), std::stof(a[2]), std::stof(a[3])};
-        parameters_[a[0]] = p;
+        int index = find(a[0]);
+        if (index != -1) // Parameters dropped from the schema are ignored
+            parameters_[index] = Parameter{std::stof(a[1]), std::stof(a[2]), std::stof(a[3])};
     }
 }
 
-void ParameterMap::set_parameter(std::string name, float value) {
-    parameters_[name].value = value;
+void ParameterMap::set_parameter(std::string_view name, float value) {
+    int index = find(name);
+    if (index != -1)
+        parameters_[index].value = value;
 }
 
-void ParameterMap::set_parameter(std::string name, Parameter parameter) {
-    parameters_[name] = parameter;
+void ParameterMap::set_parameter(std::string_view name, Parameter parameter) {
+    int index = find(name);
+    if (index != -1)
+        parameters_[index] = parameter;
 }
 
-const Parameter ParameterMap::get_parameter(std::string name) const {
-    try {
-        return parameters_.at(name);
-    } catch (...) {
+Parameter ParameterMap::get_parameter(std::string_view name) const {
+    int index = find(name);
+    if (index == -1)
         return Parameter{};
-    }
+    return parameters_[index];
 }
 
-void ParameterMap::seed_gaussian(std::string name, std::mt19937_64& rng) {
-    parameters_.at(name).seed_gaussian(rng);
+int ParameterMap::find(std::string_view name) const {
+    for (size_t i = 0; i < schema_.size(); i++) {
+        if (schema_[i].name == name)
+            return i;
+    }
+    return -1;
 }
-void ParameterMap::seed_uniform(std::string name, std::mt19937_64& rng) {
-    parameters_.at(name).seed_uniform(rng);
+
+void ParameterMap::seed(std::mt19937_64& rng) {
+    for (size_t i = 0; i < schema_.size(); i++) {
+        const ParameterInfo& info = schema_[i];
+        switch (info.seed) {
+            case ParameterSeed::NONE:
+                break;
+            case ParameterSeed::GAUSSIAN:
+                parameters_[i].seed_gaussian(rng);
+                break;
+            case ParameterSeed::UNIFORM:
+                parameters_[i].seed_uniform(rng);
+                break;
+            case ParameterSeed::HSV_GAUSSIAN:
+                parameters_[i].seed_hsv_gaussian(info.hue_min, info.hue_max, rng);
+                break;
+            case ParameterSeed::HSV_UNIFORM:
+                parameters_[i].seed_hsv_uniform(info.hue_min, info.hue_max, rng);
+                break;
+        }
+    }
 }
-void ParameterMap::seed_hsv_gaussian(std::string name, float hue_min, float hue_max, std::mt19937_64& rng) {
-    parameters_.at(name).seed_hsv_gaussian(hue_min,hue_max,rng);
+
+uint64_t ParameterMap::hash(uint64_t hash) const {
+    std::string_view raw = bytes();
+    return hash_fnv1a(raw.data(), raw.size(), hash);
 }
-void ParameterMap::seed_hsv_uniform(std::string name, float hue_min, float hue_max, std::mt19937_64& rng) {
-    parameters_.at(name).seed_hsv_uniform(hue_min,hue_max,rng);
+
+std::string_view ParameterMap::bytes() const {
+    return std::string_view((const char*)parameters_.data(), schema_.size()*sizeof(Parameter));
 }
 
 std::string ParameterMap::to_string() const {
     std::string result = "ParameterMap (";
-    for (const auto& p : parameters_) {
-        result += "(" + p.first + " " +
-        std::to_string(p.second.min) + " " + std::to_string(p.second.value) + " " + std::to_string(p.second.max) + ")";
+    for (size_t i = 0; i < schema_.size(); i++) {
+        const Parameter& p = parameters_[i];
+        result += "(" + std::string(schema_[i].name) + " " +
+        std::to_string(p.min) + " " + std::to_string(p.value) + " " + std::to_string(p.max) + ")";
     }
     result += ")";
     return result;
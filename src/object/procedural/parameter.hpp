@@ -1,12 +1,16 @@
 #pragma once
-#include <string>
-#include <map>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <random>
+#include <span>
+#include <string>
+#include <string_view>
 
 class Parameter {
 public:
-    Parameter();
-    Parameter(float min, float value, float max);
+    constexpr Parameter() : min(0), value(0), max(0) {}
+    constexpr Parameter(float min, float value, float max) : min(min), value(value), max(max) {}
 
     void seed_gaussian(std::mt19937_64& rng);
     void seed_uniform(std::mt19937_64& rng);
@@ -18,20 +22,62 @@ public:
     float max;
 };
 
+enum class ParameterSeed {
+    NONE,
+    GAUSSIAN,
+    UNIFORM,
+    HSV_GAUSSIAN, // hue in [hue_min, hue_max] mod 360, saturation and value in min/max
+    HSV_UNIFORM
+};
+
+// What changing a parameter invalidates, combined as a mask so several edits are applied in one update
+constexpr uint32_t PARAMETER_EFFECT_NONE = 0;
+constexpr uint32_t PARAMETER_EFFECT_COLOR = 1 << 0; // vertex colors only
+constexpr uint32_t PARAMETER_EFFECT_FRECKLES = 1 << 1; // freckle placement and count
+constexpr uint32_t PARAMETER_EFFECT_GEOMETRY = 1 << 2; // surface shape, everything placed on it follows
+constexpr uint32_t PARAMETER_EFFECT_TRANSFORM = 1 << 3; // placement of sub-objects only
+constexpr uint32_t PARAMETER_EFFECT_ALL = ~0u;
+
+// One row of a procedural type's constexpr parameter table. The table order is the enum order, and also the
+// order parameters draw from the rng when seeded, so appending is the only change that keeps old seeds stable.
+struct ParameterInfo {
+    std::string_view name;
+    Parameter initial;
+    uint32_t effect = PARAMETER_EFFECT_ALL;
+    ParameterSeed seed = ParameterSeed::NONE;
+    float hue_min = 0.0f;
+    float hue_max = 0.0f;
+};
+
+using ParameterSchema = std::span<const ParameterInfo>;
+
+constexpr size_t MAX_PARAMETERS = 24;
+
+// Fixed array of parameters laid out by a schema. Procedural types index it with their own enum,
+// names are only resolved for serialization and UI.
 class ParameterMap {
 public:
     ParameterMap();
-    ParameterMap(std::string data);
-    void set_parameter(std::string name, float value);
-    void set_parameter(std::string name, Parameter parameter);
-    const Parameter get_parameter(std::string name) const;
+    explicit ParameterMap(ParameterSchema schema);
+    ParameterMap(ParameterSchema schema, const std::string& data);
 
-    void seed_gaussian(std::string name, std::mt19937_64& rng);
-    void seed_uniform(std::string name, std::mt19937_64& rng);
-    void seed_hsv_gaussian(std::string name, float hue_min, float hue_max, std::mt19937_64& rng);
-    void seed_hsv_uniform(std::string name, float hue_min, float hue_max, std::mt19937_64& rng);
+    template<typename Id>
+    const Parameter& operator[](Id id) const {return parameters_[static_cast<size_t>(id)];}
+    template<typename Id>
+    Parameter& operator[](Id id) {return parameters_[static_cast<size_t>(id)];}
+
+    void set_parameter(std::string_view name, float value);
+    void set_parameter(std::string_view name, Parameter parameter);
+    Parameter get_parameter(std::string_view name) const;
+    int find(std::string_view name) const; // -1 if the schema has no such parameter
+
+    void seed(std::mt19937_64& rng);
+    uint64_t hash(uint64_t hash) const; // continues hash over the raw parameter values
+    std::string_view bytes() const; // the raw parameter values hash reads
+    ParameterSchema get_schema() const {return schema_;}
 
     std::string to_string() const;
 private:
-    std::map<std::string, Parameter> parameters_;
-};
\ No newline at end of file
+    ParameterSchema schema_;
+    std::array<Parameter, MAX_PARAMETERS> parameters_;
+};
@@ -1,16 +1,31 @@
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <iostream>
 #include <random>
+#include <unordered_map>
 
 #include "raylib.h"
 #include "raymath.h"
 
 #include "object/procedural/tapered_petal.hpp"
+#include "render/asset_cache.hpp"
+#include "render/instance_batcher.hpp"
+#include "render/mesh_disk_cache.hpp"
+#include "render/mesh_optimize.hpp"
+#include "render/mesh_queue.hpp"
 #include "util.hpp"
 
+// Bump whenever build_mesh output changes so stale meshes are never read back from the disk cache
+constexpr int MESH_VERSION = 4;
+
+static PetalMeshOptions default_mesh_options;
+
 // Returns the true float index offset, not the triplet offset
 static int vertex_index(int i, int j, const std::pair<int,int>& slices, bool bottom) {
     return ((slices.second+1)*i + j)*3 + ((slices.first+1)*(slices.second+1)*3*bottom);
@@ -41,412 +56,1003 @@ TaperedPetal::TaperedPetal(std::string data) : slices_{40,20} {
     scale_ = std::stof(split[4]);
     quaternion_ = Quaternion{std::stof(split[5]),std::stof(split[6]),std::stof(split[7]),std::stof(split[8])};
     seed_ = std::stoull(split[9]);
-    parameter_map_ = ParameterMap(split[10]);
+    parameter_map_ = ParameterMap(PETAL_SCHEMA, split[10]);
 }
 
-void TaperedPetal::generate_mesh() {
-    UnloadMesh(mesh_);
+template<typename T>
+static void append_bytes(std::string& recipe, const T& value) {
+    recipe.append((const char*)&value, sizeof(value));
+}
 
-    float length = parameter_map_.get_parameter("Length").value;
-    float width = parameter_map_.get_parameter("Width").value;
+// Every input build_mesh reads as raw bytes. The disk cache keeps it beside the mesh and compares it on load,
+// so a colliding hash can never hand back another petal's geometry.
+static std::string mesh_recipe(const PetalMeshSpec& spec) {
+    std::string recipe = "TaperedPetal";
+    append_bytes(recipe, MESH_VERSION);
+    append_bytes(recipe, spec.seed);
+    append_bytes(recipe, spec.slices.first);
+    append_bytes(recipe, spec.slices.second);
+    append_bytes(recipe, spec.tessellation_tolerance);
+    append_bytes(recipe, spec.single_sided);
+    append_bytes(recipe, spec.vertex_format);
+    recipe += spec.parameters.bytes();
+    return recipe;
+}
 
-    float u_step = length/(1.0f*slices_.first);
-    float v_step = 2.0f*width/(1.0f*slices_.second);
+// Hash of the mesh recipe, petals that match share one immutable mesh
+static uint64_t mesh_hash(const PetalMeshSpec& spec) {
+    const std::string recipe = mesh_recipe(spec);
+    return hash_fnv1a(recipe.data(), recipe.size());
+}
 
-    // Generate Freckle Positions
-    std::vector<unsigned short> freckle_positions {};
-    std::mt19937_64 rng(seed_);
-    std::uniform_real_distribution<double> dist(0.0f,1.0f);
-    for (int i = 0; i <= slices_.first; i++) {
-        for (int j = 0; j <= slices_.second; j++) {
-            float u = i*u_step;
-            int index_top = vertex_index(i,j,slices_,false);
-            float roll = dist(rng);
-            float freckle_coverage = parameter_map_.get_parameter("FreckleCoverage").value;
-            float freckle_chance = parameter_map_.get_parameter("FreckleAmount").value*std::powf(1.0f-u/(length*freckle_coverage),parameter_map_.get_parameter("FreckleCentrality").value);
-            if (i > 1 && j > 1 && j < slices_.second-1 && u/length < freckle_coverage && roll < freckle_chance)
-                freckle_positions.emplace_back(index_top);
+static MeshData build_petal_mesh(const PetalMeshSpec& spec);
+
+// Editing a parameter changes the hash, so the petal moves to another entry and never alters a shared mesh
+static MeshData load_mesh_data(const PetalMeshSpec& spec) {
+    MeshData data;
+    const std::string recipe = mesh_recipe(spec);
+    uint64_t disk_key = MeshDiskCache::key(hash_fnv1a(recipe.data(), recipe.size()));
+    if (!MeshDiskCache::load(disk_key, recipe, data)) {
+        // Reordering is paid once per unique mesh here, the disk cache keeps the order and edits skip it
+        data = build_petal_mesh(spec);
+        optimize_vertex_cache(data);
+        MeshDiskCache::store(disk_key, recipe, data);
+    }
+    // Off the main thread whenever the mesh is, uploads only add it up
+    data.cache_miss_ratio = average_cache_miss_ratio(data);
+    return data;
+}
+
+static std::shared_ptr<const Mesh> acquire_mesh(const PetalMeshSpec& spec) {
+    uint64_t hash = mesh_hash(spec);
+    if (std::shared_ptr<const Mesh> mesh = AssetCache::find_mesh(hash))
+        return mesh;
+    return AssetCache::insert_mesh(hash, upload_mesh(load_mesh_data(spec), spec.vertex_format));
+}
+
+PetalMeshSpec TaperedPetal::mesh_spec(std::pair<int,int> slices) const {
+    return PetalMeshSpec{parameter_map_, seed_, slices, tessellation_tolerance_, single_sided_, vertex_format_};
+}
+
+uint64_t TaperedPetal::content_hash(std::pair<int,int> slices) const {
+    return mesh_hash(mesh_spec(slices));
+}
+
+// Staged meshes not uploaded yet by content hash, a world full of one cultivar builds each petal mesh once
+static std::mutex staging_mutex;
+static std::unordered_map<uint64_t, std::weak_ptr<StagedMesh>> staging;
+static size_t staging_sweep_size = 64; // petals edited or destroyed before generating leave expired entries
+
+// The job only holds a copy of the spec and the staged holder, so the petal can be edited or destroyed while
+// it runs. Others building the same mesh wait in call_once until it is done.
+std::function<void()> TaperedPetal::mesh_job() {
+    const PetalMeshSpec spec = mesh_spec(slices_);
+    uint64_t hash = mesh_hash(spec);
+    if (AssetCache::contains_mesh(hash))
+        return {};
+    std::shared_ptr<StagedMesh> staged;
+    {
+        std::lock_guard lock(staging_mutex);
+        std::weak_ptr<StagedMesh>& entry = staging[hash];
+        if ((staged = entry.lock()) == nullptr) {
+            entry = staged = std::make_shared<StagedMesh>();
+            // Whenever the map doubles, the entry just made stays since staged holds it
+            if (staging.size() >= staging_sweep_size) {
+                std::erase_if(staging, [](const auto& p) {return p.second.expired();});
+                staging_sweep_size = std::max<size_t>(64, staging.size()*2);
+            }
         }
     }
+    staged_ = staged;
+    staged_hash_ = hash;
+    return [spec, staged]() {std::call_once(staged->built, [&]() {staged->data = load_mesh_data(spec);});};
+}
 
-    int petal_vertex_count = (slices_.first+1)*(slices_.second+1)*2; // Dual Sided
-    int petal_triangle_count = (slices_.first*slices_.second)*2*2; // Dual Sided
-
-    int freckle_vertex_count = freckle_positions.size()*9;
-    int freckle_triangle_count = freckle_positions.size()*8;
-
-    mesh_ = Mesh{0};
-    mesh_.vertexCount = petal_vertex_count + freckle_vertex_count;
-    mesh_.triangleCount = petal_triangle_count + freckle_triangle_count;
-    mesh_.vertices = (float*)MemAlloc(mesh_.vertexCount*sizeof(float)*3);
-    mesh_.indices = (unsigned short*)MemAlloc(mesh_.triangleCount*sizeof(unsigned short)*3);
-    mesh_.colors = (unsigned char*)MemAlloc(mesh_.vertexCount*sizeof(unsigned char)*4);
-    mesh_.normals = (float*)MemAlloc(mesh_.vertexCount*sizeof(float)*3);
-    std::memset(mesh_.normals, 0, mesh_.vertexCount*sizeof(float)*3);
-
-    for (int i = 0; i <= slices_.first; i++) {
-        for (int j = 0; j <= slices_.second; j++) {
-            float u = i*u_step;
-            float v = j*v_step - width;
-            int index_top = vertex_index(i,j,slices_,false);
-            int index_bottom = vertex_index(i,j,slices_,true);
-            float x = X(u,v);
-            float y = Y(u,v);
-            float z = Z(u,v);
-            mesh_.vertices[index_top] = x;
-            mesh_.vertices[index_top+1] = y;
-            mesh_.vertices[index_top+2] = z;
-
-            mesh_.vertices[index_bottom] = x;
-            mesh_.vertices[index_bottom+1] = y;
-            mesh_.vertices[index_bottom+2] = z;
-
-            Color base = ColorFromHSV(parameter_map_.get_parameter("BaseColor").min,
-                                        parameter_map_.get_parameter("BaseColor").value,
-                                        parameter_map_.get_parameter("BaseColor").max);
-            Color gradient = ColorFromHSV(parameter_map_.get_parameter("GradientColor").min,
-                                        parameter_map_.get_parameter("GradientColor").value,
-                                        parameter_map_.get_parameter("GradientColor").max);
-            Color border = ColorFromHSV(parameter_map_.get_parameter("BorderColor").min,
-                                        parameter_map_.get_parameter("BorderColor").value,
-                                        parameter_map_.get_parameter("BorderColor").max);
-            Color stripe = ColorFromHSV(parameter_map_.get_parameter("StripeColor").min,
-                                        parameter_map_.get_parameter("StripeColor").value,
-                                        parameter_map_.get_parameter("StripeColor").max);
-
-            float gradient_width = parameter_map_.get_parameter("GradientWidth").value;
-            float gradient_amount = std::max<float>(gradient_width-(length-u)/length,0.0f)/gradient_width;
-            if (gradient_width == 0.0f) gradient_amount = 0.0f;
-
-            float border_width = parameter_map_.get_parameter("BorderWidth").value;
-            float border_amount = std::max<float>(border_width-(width-std::abs(v))/width,0.0f)/border_width;
-            if (border_width == 0.0f) border_amount = 0.0f;
-
-            float stripe_width = parameter_map_.get_parameter("StripeWidth").value;
-            float stripe_amount = std::max<float>(stripe_width-std::abs(v)/width,0.0f)/stripe_width;
-            if (stripe_width == 0.0f) stripe_amount = 0.0f;
-
-            float r = lerp(base.r,gradient.r,gradient_amount);
-            float g = lerp(base.g,gradient.g,gradient_amount);
-            float b = lerp(base.b,gradient.b,gradient_amount);
-
-            r = lerp(r, border.r, border_amount);
-            g = lerp(g, border.g, border_amount);
-            b = lerp(b, border.b, border_amount);
-
-            r = lerp(r, stripe.r, stripe_amount);
-            g = lerp(g, stripe.g, stripe_amount);
-            b = lerp(b, stripe.b, stripe_amount);
-
-            mesh_.colors[4*index_top/3] = (unsigned short) r;
-            mesh_.colors[4*index_top/3+1] = (unsigned short) g;
-            mesh_.colors[4*index_top/3+2] = (unsigned short) b;
-            mesh_.colors[4*index_top/3+3] = 255;
-
-            mesh_.colors[4*index_bottom/3] = (unsigned short) r;
-            mesh_.colors[4*index_bottom/3+1] = (unsigned short) g;
-            mesh_.colors[4*index_bottom/3+2] = (unsigned short) b;
-            mesh_.colors[4*index_bottom/3+3] = 255;
+void TaperedPetal::generate_mesh() {
+    lods_ = {};
+    lod_requests_ = {};
+    changed_effects_ = PARAMETER_EFFECT_NONE;
+    mesh_hash_ = content_hash(slices_);
+    std::shared_ptr<const Mesh> mesh = AssetCache::find_mesh(mesh_hash_);
+    if (mesh == nullptr && staged_ != nullptr && staged_hash_ == mesh_hash_) {
+        // Built here if the job has not run yet, waited for if a worker is on it
+        std::call_once(staged_->built, [&]() {staged_->data = load_mesh_data(mesh_spec(slices_));});
+        mesh = AssetCache::insert_mesh(mesh_hash_, upload_mesh(staged_->data, vertex_format_));
+    }
+    if (staged_ != nullptr) {
+        staged_.reset();
+        std::lock_guard lock(staging_mutex);
+        auto entry = staging.find(staged_hash_);
+        if (entry != staging.end() && entry->second.expired())
+            staging.erase(entry);
+    }
+    set_mesh(mesh != nullptr ? mesh : acquire_mesh(mesh_spec(slices_)));
+    update_matrix();
+    refit_bvh(); // bounds change with the mesh, petals generated after being indexed must move their leaf
+}
+
+// Whether data has the live mesh's triangles in any order. Loaded meshes had theirs reordered for the vertex
+// cache and a rebuild comes out in grid order, the vertex arrays and windings are the same either way.
+static bool same_triangles(const MeshData& data, const Mesh& mesh) {
+    if (data.vertex_count() != mesh.vertexCount || data.triangle_count() != mesh.triangleCount || mesh.indices == nullptr)
+        return false;
+    if (std::equal(data.indices.begin(), data.indices.end(), mesh.indices))
+        return true;
+    auto sorted_triangles = [](const unsigned short* indices, int triangles) {
+        std::vector<uint64_t> keys(triangles);
+        for (int t = 0; t < triangles; t++)
+            keys[t] = (uint64_t)indices[t*3] << 32 | (uint64_t)indices[t*3+1] << 16 | indices[t*3+2];
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    };
+    return sorted_triangles(data.indices.data(), data.triangle_count()) == sorted_triangles(mesh.indices, mesh.triangleCount);
+}
+
+void TaperedPetal::update_mesh() {
+    if (mesh_ == nullptr) {
+        generate_mesh();
+        return;
+    }
+    const uint32_t changed = changed_effects_;
+    changed_effects_ = PARAMETER_EFFECT_NONE;
+    uint64_t hash = content_hash(slices_);
+    if (changed == PARAMETER_EFFECT_NONE || hash == mesh_hash_)
+        return;
+    lods_ = {}; // coarse levels are cheap and rebuilt the next time they are drawn
+    lod_requests_ = {};
+
+    if (std::shared_ptr<const Mesh> cached = AssetCache::find_mesh(hash)) {
+        set_mesh(cached);
+    } else {
+        // Colors alone keep the layout unless adaptive tessellation, which also looks at colors, is on.
+        // Freckles, with or without colors, keep the surface and only redo the fans, under the same condition.
+        // Anything else rebuilds the vertex streams and reuses the buffers if the triangles came out the same,
+        // which for an adaptive color edit means only the colors need uploading.
+        const bool adaptive = tessellation_tolerance_ != 0.0f;
+        MeshData data;
+        uint32_t streams = MESH_STREAM_ALL;
+        bool same_layout;
+        const bool freckles_only = (changed & PARAMETER_EFFECT_FRECKLES) && !(changed & ~(PARAMETER_EFFECT_FRECKLES | PARAMETER_EFFECT_COLOR));
+        if (changed == PARAMETER_EFFECT_COLOR && !adaptive) {
+            data.colors = build_colors(mesh_->vertexCount);
+            streams = MESH_STREAM_COLORS;
+            same_layout = true;
+        } else {
+            if (freckles_only && !adaptive)
+                data = rebuild_freckles();
+            if (data.vertices.empty())
+                data = build_mesh();
+            same_layout = same_triangles(data, *mesh_);
+            if (same_layout && changed == PARAMETER_EFFECT_COLOR)
+                streams = MESH_STREAM_COLORS;
+        }
+        if (same_layout && AssetCache::update_mesh(mesh_, mesh_hash_, hash, data, streams, vertex_format_)) {
+            if (streams & MESH_STREAM_POSITIONS)
+                update_local_bounds();
+        } else {
+            if (data.vertices.empty())
+                data = build_mesh();
+            set_mesh(AssetCache::insert_mesh(hash, upload_mesh(data, vertex_format_)));
         }
     }
+    mesh_hash_ = hash;
+    update_matrix();
+    refit_bvh();
+}
 
-    int triangle_index = 0;
-    for (int i = 0; i <= slices_.first-1; i++) {
-        for (int j = 0; j <= slices_.second-1; j++) {
-            int index = vertex_index(i,j,slices_,false);
-            int index_two = vertex_index(i+1,j,slices_,false);
-            int index_three = vertex_index(i,j+1,slices_,false);
-            int index_four = vertex_index(i+1,j+1,slices_,false);
-
-            mesh_.indices[triangle_index] = index/3;
-            mesh_.indices[triangle_index+1] = index_three/3;
-            mesh_.indices[triangle_index+2] = index_four/3;
-
-            mesh_.indices[triangle_index+3] = index_two/3;
-            mesh_.indices[triangle_index+4] = index/3;
-            mesh_.indices[triangle_index+5] = index_four/3;
-
-            Vector3 a = Vector3Subtract(Vector3{mesh_.vertices[index_three],mesh_.vertices[index_three+1],mesh_.vertices[index_three+2]},
-                                        Vector3{mesh_.vertices[index],mesh_.vertices[index+1],mesh_.vertices[index+2]});          
-            Vector3 b = Vector3Subtract(Vector3{mesh_.vertices[index_four],mesh_.vertices[index_four+1],mesh_.vertices[index_four+2]},
-                                        Vector3{mesh_.vertices[index],mesh_.vertices[index+1],mesh_.vertices[index+2]});
-            Vector3 c = Vector3Subtract(Vector3{mesh_.vertices[index],mesh_.vertices[index+1],mesh_.vertices[index+2]},
-                                        Vector3{mesh_.vertices[index_two],mesh_.vertices[index_two+1],mesh_.vertices[index_two+2]});          
-            Vector3 d = Vector3Subtract(Vector3{mesh_.vertices[index_four],mesh_.vertices[index_four+1],mesh_.vertices[index_four+2]},
-                                        Vector3{mesh_.vertices[index_two],mesh_.vertices[index_two+1],mesh_.vertices[index_two+2]});
-            Vector3 norm = Vector3Normalize(Vector3CrossProduct(a,b));
-            if (norm.x == 0 && norm.y == 0 && norm.z == 0)
-                norm = Vector3Normalize(Vector3CrossProduct(c,d));
-            mesh_.normals[index] += norm.x;
-            mesh_.normals[index+1] += norm.y;
-            mesh_.normals[index+2] += norm.z;
-            mesh_.normals[index_two] += norm.x;
-            mesh_.normals[index_two+1] += norm.y;
-            mesh_.normals[index_two+2] += norm.z;
-            mesh_.normals[index_three] += norm.x;
-            mesh_.normals[index_three+1] += norm.y;
-            mesh_.normals[index_three+2] += norm.z;
-            mesh_.normals[index_four] += norm.x;
-            mesh_.normals[index_four+1] += norm.y;
-            mesh_.normals[index_four+2] += norm.z;
+// Requests still building, keyed by content hash so identical petals share one job
+static std::unordered_map<uint64_t, std::weak_ptr<std::shared_ptr<const Mesh>>> pending_lods;
 
-            triangle_index += 6;
+// Coarser levels are only built the first time something far enough away asks for them. Building one means
+// evaluating the petal and maybe reading the disk cache, so it goes through MeshQueue like any other mesh.
+void TaperedPetal::request_lod(int level) const {
+    if (lod_requests_[level] != nullptr) {
+        if (*lod_requests_[level] != nullptr) {
+            lods_[level] = *lod_requests_[level];
+            lod_requests_[level].reset();
+        }
+        return;
+    }
+    const PetalMeshSpec spec = mesh_spec({std::min(LOD_SLICES[level].first, slices_.first), std::min(LOD_SLICES[level].second, slices_.second)});
+    const uint64_t hash = mesh_hash(spec);
+    if ((lods_[level] = AssetCache::find_mesh(hash)) != nullptr)
+        return;
+    if (auto pending = pending_lods.find(hash); pending != pending_lods.end()) {
+        if ((lod_requests_[level] = pending->second.lock()) != nullptr)
+            return;
+    }
 
-            // Back side
+    lod_requests_[level] = std::make_shared<std::shared_ptr<const Mesh>>();
+    pending_lods[hash] = lod_requests_[level];
+    auto data = std::make_shared<MeshData>();
+    MeshQueue::enqueue([spec, data]() {*data = load_mesh_data(spec);},
+        [spec, hash, data, request = std::weak_ptr(lod_requests_[level])]() {
+            pending_lods.erase(hash);
+            std::shared_ptr<std::shared_ptr<const Mesh>> slot = request.lock();
+            if (slot == nullptr)
+                return false; // every petal that asked has been edited or destroyed since
+            if (data->vertices.empty())
+                *data = load_mesh_data(spec);
+            *slot = AssetCache::insert_mesh(hash, upload_mesh(*data, spec.vertex_format));
+            return true;
+        });
+}
 
-            index = vertex_index(i,j,slices_,true);
-            index_two = vertex_index(i+1,j,slices_,true);
-            index_three = vertex_index(i,j+1,slices_,true);
-            index_four = vertex_index(i+1,j+1,slices_,true);
-
-            mesh_.indices[triangle_index] = index_three/3;
-            mesh_.indices[triangle_index+1] = index/3;
-            mesh_.indices[triangle_index+2] = index_four/3;
-
-            mesh_.indices[triangle_index+3] = index/3;
-            mesh_.indices[triangle_index+4] = index_two/3;
-            mesh_.indices[triangle_index+5] = index_four/3;
-
-            a = Vector3Subtract(Vector3{mesh_.vertices[index],mesh_.vertices[index+1],mesh_.vertices[index+2]},
-                                        Vector3{mesh_.vertices[index_three],mesh_.vertices[index_three+1],mesh_.vertices[index_three+2]});          
-            b = Vector3Subtract(Vector3{mesh_.vertices[index_four],mesh_.vertices[index_four+1],mesh_.vertices[index_four+2]},
-                                        Vector3{mesh_.vertices[index_three],mesh_.vertices[index_three+1],mesh_.vertices[index_three+2]});
-            c = Vector3Subtract(Vector3{mesh_.vertices[index_four],mesh_.vertices[index_four+1],mesh_.vertices[index_four+2]},
-                                        Vector3{mesh_.vertices[index_two],mesh_.vertices[index_two+1],mesh_.vertices[index_two+2]});          
-            d = Vector3Subtract(Vector3{mesh_.vertices[index],mesh_.vertices[index+1],mesh_.vertices[index+2]},
-                                        Vector3{mesh_.vertices[index_two],mesh_.vertices[index_two+1],mesh_.vertices[index_two+2]});
-            norm = Vector3Normalize(Vector3CrossProduct(a,b));
-            if (norm.x == 0 && norm.y == 0 && norm.z == 0)
-                norm = Vector3Normalize(Vector3CrossProduct(c,d));
-            mesh_.normals[index] += norm.x;
-            mesh_.normals[index+1] += norm.y;
-            mesh_.normals[index+2] += norm.z;
-            mesh_.normals[index_two] += norm.x;
-            mesh_.normals[index_two+1] += norm.y;
-            mesh_.normals[index_two+2] += norm.z;
-            mesh_.normals[index_three] += norm.x;
-            mesh_.normals[index_three+1] += norm.y;
-            mesh_.normals[index_three+2] += norm.z;
-            mesh_.normals[index_four] += norm.x;
-            mesh_.normals[index_four+1] += norm.y;
-            mesh_.normals[index_four+2] += norm.z;
+const std::shared_ptr<const Mesh>& TaperedPetal::get_lod_mesh(int level) const {
+    if (level <= 0 || mesh_ == nullptr)
+        return mesh_;
+    if (lods_[level] == nullptr)
+        request_lod(level);
+    if (lods_[level] != nullptr)
+        return lods_[level];
+    // Finer levels first, a petal drawn in too much detail for a few frames is not noticed
+    for (int distance = 1; distance < LOD_COUNT; distance++) {
+        if (level - distance <= 0)
+            return mesh_;
+        if (lods_[level - distance] != nullptr)
+            return lods_[level - distance];
+        if (level + distance < LOD_COUNT && lods_[level + distance] != nullptr)
+            return lods_[level + distance];
+    }
+    return mesh_;
+}
 
-            triangle_index += 6;
+void TaperedPetal::submit(InstanceBatcher& batcher) const {
+    lod_level_ = select_lod(screen_size(batcher.get_view(), get_bounding_box()), lod_level_);
+    batcher.add(get_lod_mesh(lod_level_), transform_, !single_sided_);
+}
+void TaperedPetal::submit(InstanceBatcher& batcher, const Matrix& transform) const {
+    if (mesh_ != nullptr)
+        batcher.add_draw(*mesh_, *material_, transform, !single_sided_);
+}
+
+// Everything build_mesh needs from the parameter map, resolved once per mesh instead of per vertex
+struct PetalKernel {
+    int rows; // slices along the length, the grid has rows+1 vertices along u
+    int columns; // slices across the width, the grid has columns+1 vertices along v
+    float length;
+    float width;
+    float u_step;
+    float v_step;
+    float midpoint;
+    float a;
+    float t3;
+    float curvature;
+    float fold; // +1 convex, -1 concave
+    bool crease;
+    float taper_exponent;
+
+    Color base;
+    Color gradient;
+    Color border;
+    Color stripe;
+    Color freckle;
+    float gradient_width;
+    float border_width;
+    float stripe_width;
+
+    float freckle_amount;
+    float freckle_centrality;
+    float freckle_coverage;
+    float freckle_size;
+};
+
+static Color hsv_parameter(const ParameterMap& map, PetalParameter id) {
+    const Parameter& hsv = map[id];
+    return ColorFromHSV(hsv.min, hsv.value, hsv.max);
+}
+
+static PetalKernel resolve_kernel(const ParameterMap& map, std::pair<int,int> slices) {
+    PetalKernel k;
+    k.rows = slices.first;
+    k.columns = slices.second;
+    k.length = map[PetalParameter::LENGTH].value;
+    k.width = map[PetalParameter::WIDTH].value;
+    k.u_step = k.length/(1.0f*k.rows);
+    k.v_step = 2.0f*k.width/(1.0f*k.columns);
+
+    float height = map[PetalParameter::HEIGHT].value;
+    float curl = map[PetalParameter::CURL].value;
+    k.crease = map[PetalParameter::CREASE_BOOLEAN].value > 0.5f;
+    k.fold = map[PetalParameter::CONCAVE_BOOLEAN].value > 0.5f ? -1.0f : 1.0f;
+    k.curvature = map[PetalParameter::CURVATURE].value;
+    if (k.crease)
+        k.curvature = k.curvature*k.curvature;
+    k.midpoint = k.length*curl/3.0f;
+    k.a = std::sqrt(height)/k.midpoint;
+    k.t3 = (k.midpoint*k.a)*(k.midpoint*k.a);
+    k.taper_exponent = 1/(4.0f-3.0f*map[PetalParameter::SHARPNESS].value);
+
+    k.base = hsv_parameter(map, PetalParameter::BASE_COLOR);
+    k.gradient = hsv_parameter(map, PetalParameter::GRADIENT_COLOR);
+    k.border = hsv_parameter(map, PetalParameter::BORDER_COLOR);
+    k.stripe = hsv_parameter(map, PetalParameter::STRIPE_COLOR);
+    k.freckle = hsv_parameter(map, PetalParameter::FRECKLE_COLOR);
+    k.gradient_width = map[PetalParameter::GRADIENT_WIDTH].value;
+    k.border_width = map[PetalParameter::BORDER_WIDTH].value;
+    k.stripe_width = map[PetalParameter::STRIPE_WIDTH].value;
+
+    k.freckle_amount = map[PetalParameter::FRECKLE_AMOUNT].value;
+    k.freckle_centrality = map[PetalParameter::FRECKLE_CENTRALITY].value;
+    k.freckle_coverage = map[PetalParameter::FRECKLE_COVERAGE].value;
+    k.freckle_size = map[PetalParameter::FRECKLE_SIZE].value;
+    return k;
+}
+
+// Half width of the petal at u as a fraction of Width, this is what tapers the outline to a point
+static float petal_taper(const PetalKernel& k, float u) {
+    float temp = std::abs(-4.0f*(u-k.length/2.0f)*(u-k.length/2.0f)/(k.length*k.length)+1);
+    return std::pow(temp, k.taper_exponent);
+}
+
+// Heights and widths of one row of the grid, u is fixed along a row so only v varies
+static void petal_row(const PetalKernel& k, float u, float* ys, float* zs) {
+    float taper = petal_taper(k, u);
+    float t1 = (k.a*(u-k.midpoint))*(k.a*(u-k.midpoint));
+    int count = k.columns+1;
+    for (int j = 0; j < count; j++) {
+        float v = j*k.v_step - k.width;
+        float z = v*taper;
+        float bend = k.curvature*z/k.width;
+        float t2 = k.crease ? std::abs(bend) : bend*bend;
+        zs[j] = z;
+        ys[j] = -t1 + k.fold*t2 + k.t3;
+    }
+}
+
+// Blend weights for the border and stripe bands, both only depend on v so they are shared by every row
+static void band_weights(const PetalKernel& k, float* border, float* stripe) {
+    for (int j = 0; j <= k.columns; j++) {
+        float v = j*k.v_step - k.width;
+        border[j] = k.border_width == 0.0f ? 0.0f : std::max<float>(k.border_width-(k.width-std::abs(v))/k.width,0.0f)/k.border_width;
+        stripe[j] = k.stripe_width == 0.0f ? 0.0f : std::max<float>(k.stripe_width-std::abs(v)/k.width,0.0f)/k.stripe_width;
+    }
+}
+
+static void blend_channel(float base, float gradient, float border, float stripe, float gradient_amount, const float* border_amount, const float* stripe_amount, int count, float* out) {
+    float row = base + gradient_amount*(gradient-base);
+    for (int j = 0; j < count; j++) {
+        float c = row + border_amount[j]*(border-row);
+        out[j] = c + stripe_amount[j]*(stripe-c);
+    }
+}
+
+// Colors of one grid row at u, across count vertices
+static void row_colors(const PetalKernel& k, float u, const float* border_amount, const float* stripe_amount, int count, float* r, float* g, float* b) {
+    float gradient_amount = k.gradient_width == 0.0f ? 0.0f : std::max<float>(k.gradient_width-(k.length-u)/k.length,0.0f)/k.gradient_width;
+    blend_channel(k.base.r, k.gradient.r, k.border.r, k.stripe.r, gradient_amount, border_amount, stripe_amount, count, r);
+    blend_channel(k.base.g, k.gradient.g, k.border.g, k.stripe.g, gradient_amount, border_amount, stripe_amount, count, g);
+    blend_channel(k.base.b, k.gradient.b, k.border.b, k.stripe.b, gradient_amount, border_amount, stripe_amount, count, b);
+}
+
+static Vector3 face_normal(Vector3 a, Vector3 b, Vector3 c, Vector3 d) {
+    Vector3 norm = Vector3Normalize(Vector3CrossProduct(a,b));
+    if (norm.x == 0 && norm.y == 0 && norm.z == 0)
+        norm = Vector3Normalize(Vector3CrossProduct(c,d));
+    return norm;
+}
+
+// Largest color change, in 8 bit levels, that adaptive tessellation may smooth over
+constexpr float COLOR_TOLERANCE = 4.0f;
+
+// Full grid samples, one entry per grid vertex in row order
+struct PetalGrid {
+    std::vector<float> x, y, z;
+    std::vector<float> r, g, b;
+
+    Vector3 position(int index) const {return Vector3{x[index], y[index], z[index]};}
+};
+
+// Per-vertex normals of the full grid on one side, each vertex sums the face normals of its up to four quads
+static std::vector<Vector3> grid_normals(const PetalGrid& grid, int rows, int columns, bool back) {
+    const int quad_columns = columns-1;
+    std::vector<Vector3> faces(rows*quad_columns);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < quad_columns; j++) {
+            int index = i*columns + j;
+            Vector3 p = grid.position(index);
+            Vector3 p_two = grid.position(index+columns);
+            Vector3 p_three = grid.position(index+1);
+            Vector3 p_four = grid.position(index+columns+1);
+            faces[i*quad_columns + j] = back
+                ? face_normal(Vector3Subtract(p,p_three), Vector3Subtract(p_four,p_three), Vector3Subtract(p_four,p_two), Vector3Subtract(p,p_two))
+                : face_normal(Vector3Subtract(p_three,p), Vector3Subtract(p_four,p), Vector3Subtract(p,p_two), Vector3Subtract(p_four,p_two));
+        }
+    }
+    std::vector<Vector3> normals((rows+1)*columns);
+    for (int i = 0; i <= rows; i++) {
+        for (int j = 0; j <= quad_columns; j++) {
+            Vector3 norm = {0.0f, 0.0f, 0.0f};
+            if (i > 0 && j > 0) norm = Vector3Add(norm, faces[(i-1)*quad_columns + j-1]);
+            if (i > 0 && j < quad_columns) norm = Vector3Add(norm, faces[(i-1)*quad_columns + j]);
+            if (i < rows && j > 0) norm = Vector3Add(norm, faces[i*quad_columns + j-1]);
+            if (i < rows && j < quad_columns) norm = Vector3Add(norm, faces[i*quad_columns + j]);
+            normals[i*columns + j] = Vector3Normalize(norm);
         }
     }
+    return normals;
+}
 
-    for (int i = 0; i < mesh_.vertexCount; i++) {
-        int index = i*3;
-        Vector3 vertex = {mesh_.vertices[index], mesh_.vertices[index+1], mesh_.vertices[index+2]};
-    }
-    for (int i = 0; i < mesh_.vertexCount; i++) {
-        int normal_index = i*3;
-        Vector3 norm = {mesh_.normals[normal_index], mesh_.normals[normal_index+1], mesh_.normals[normal_index+2]};
-        norm = Vector3Normalize(norm);
-        mesh_.normals[normal_index] = norm.x;
-        mesh_.normals[normal_index+1] = norm.y;
-        mesh_.normals[normal_index+2] = norm.z;
-    }
-
-    int freckle_index = petal_vertex_count*3;
-    for (unsigned short index_vertex : freckle_positions) {
-        constexpr float ROOT2_2 = 0.7071067811865475244f;
-        constexpr float epsilon = 0.0001f; // Prevent Z-fighting
-        
-        Color freckle_color = ColorFromHSV(parameter_map_.get_parameter("FreckleColor").min,
-                                        parameter_map_.get_parameter("FreckleColor").value,
-                                        parameter_map_.get_parameter("FreckleColor").max);
-        Vector3 normal = Vector3{mesh_.normals[index_vertex],mesh_.normals[index_vertex+1],mesh_.normals[index_vertex+2]};
-        Vector3 position = Vector3Add(Vector3{mesh_.vertices[index_vertex],mesh_.vertices[index_vertex+1],mesh_.vertices[index_vertex+2]},
-                                    normal*epsilon);
-        Vector3 other = Vector3{0,0,1};
-        Vector3 tangent = Vector3Normalize(Vector3CrossProduct(normal,other));
-        assert((tangent.x != 0.0f || tangent.y != 0.0f || tangent.z != 0.0f));
-        Vector3 binormal = Vector3Normalize(Vector3CrossProduct(normal,tangent));
-
-        const float ELLIPSE_A = parameter_map_.get_parameter("FreckleSize").value*parameter_map_.get_parameter("Length").value/100.0f;
-        const float ELLIPSE_B = parameter_map_.get_parameter("FreckleSize").value*parameter_map_.get_parameter("Width").value/100.0f;
-
-        const float TANGENT_COMP_X = ELLIPSE_A*ROOT2_2*tangent.x;
-        const float TANGENT_COMP_Y = ELLIPSE_A*ROOT2_2*tangent.y;
-        const float TANGENT_COMP_Z = ELLIPSE_A*ROOT2_2*tangent.z;
-
-        const float BINORMAL_COMP_X = ELLIPSE_B*ROOT2_2*binormal.x;
-        const float BINORMAL_COMP_Y = ELLIPSE_B*ROOT2_2*binormal.y;
-        const float BINORMAL_COMP_Z = ELLIPSE_B*ROOT2_2*binormal.z;
-
-        mesh_.vertices[freckle_index] = position.x;
-        mesh_.vertices[freckle_index+1] = position.y;
-        mesh_.vertices[freckle_index+2] = position.z;
-        
-        mesh_.vertices[freckle_index+3] = position.x + ELLIPSE_A*tangent.x; // 0 Degrees
-        mesh_.vertices[freckle_index+4] = position.y + ELLIPSE_A*tangent.y;
-        mesh_.vertices[freckle_index+5] = position.z + ELLIPSE_A*tangent.z;
-
-        mesh_.vertices[freckle_index+6] = position.x + TANGENT_COMP_X + BINORMAL_COMP_X; // 45 Degrees
-        mesh_.vertices[freckle_index+7] = position.y + TANGENT_COMP_Y + BINORMAL_COMP_Y;
-        mesh_.vertices[freckle_index+8] = position.z + TANGENT_COMP_Z + BINORMAL_COMP_Z;
-
-        mesh_.vertices[freckle_index+9] = position.x + ELLIPSE_B*binormal.x; // 90 Degrees
-        mesh_.vertices[freckle_index+10] = position.y + ELLIPSE_B*binormal.y;
-        mesh_.vertices[freckle_index+11] = position.z + ELLIPSE_B*binormal.z;
-
-        mesh_.vertices[freckle_index+12] = position.x - TANGENT_COMP_X + BINORMAL_COMP_X; // 135 Degrees
-        mesh_.vertices[freckle_index+13] = position.y - TANGENT_COMP_Y + BINORMAL_COMP_Y;
-        mesh_.vertices[freckle_index+14] = position.z - TANGENT_COMP_Z + BINORMAL_COMP_Z;
-
-        mesh_.vertices[freckle_index+15] = position.x - ELLIPSE_A*tangent.x; // 180 Degrees
-        mesh_.vertices[freckle_index+16] = position.y - ELLIPSE_A*tangent.y;
-        mesh_.vertices[freckle_index+17] = position.z - ELLIPSE_A*tangent.z;
-
-        mesh_.vertices[freckle_index+18] = position.x - TANGENT_COMP_X - BINORMAL_COMP_X; // 225 Degrees
-        mesh_.vertices[freckle_index+19] = position.y - TANGENT_COMP_Y - BINORMAL_COMP_Y;
-        mesh_.vertices[freckle_index+20] = position.z - TANGENT_COMP_Z - BINORMAL_COMP_Z;
-
-        mesh_.vertices[freckle_index+21] = position.x - ELLIPSE_B*binormal.x; // 270 Degrees
-        mesh_.vertices[freckle_index+22] = position.y - ELLIPSE_B*binormal.y;
-        mesh_.vertices[freckle_index+23] = position.z - ELLIPSE_B*binormal.z;
-
-        mesh_.vertices[freckle_index+24] = position.x + TANGENT_COMP_X - BINORMAL_COMP_X; // 315 Degrees
-        mesh_.vertices[freckle_index+25] = position.y + TANGENT_COMP_Y - BINORMAL_COMP_Y;
-        mesh_.vertices[freckle_index+26] = position.z + TANGENT_COMP_Z - BINORMAL_COMP_Z;
-
-        int freckle_position = freckle_index/3;
-        for (int i = freckle_position; i <= freckle_position + 8; i++) {
-            mesh_.normals[i*3] = normal.x;
-            mesh_.normals[i*3+1] = normal.y;
-            mesh_.normals[i*3+2] = normal.z;
-            mesh_.colors[i*4] = freckle_color.r;
-            mesh_.colors[i*4+1] = freckle_color.g;
-            mesh_.colors[i*4+2] = freckle_color.b;
-            mesh_.colors[i*4+3] = 255;
+// Grid rows [i0, i1] and columns [j0, j1], corners included
+struct GridCell {
+    int i0, i1;
+    int j0, j1;
+};
+
+// Whether every sample of the cell is within tolerance of the two triangles its corners are split into, in
+// position and color, with no pinned sample other than the corners
+static bool cell_fits(const PetalGrid& grid, int columns, const GridCell& cell, float tolerance, const std::vector<bool>& pinned) {
+    const int c00 = cell.i0*columns + cell.j0;
+    const int c01 = cell.i0*columns + cell.j1;
+    const int c10 = cell.i1*columns + cell.j0;
+    const int c11 = cell.i1*columns + cell.j1;
+    auto blend = [&](const std::vector<float>& values, float s, float t) {
+        if (s + t <= 1.0f)
+            return values[c00] + t*(values[c01]-values[c00]) + s*(values[c10]-values[c00]);
+        return values[c11] + (1.0f-t)*(values[c10]-values[c11]) + (1.0f-s)*(values[c01]-values[c11]);
+    };
+    for (int i = cell.i0; i <= cell.i1; i++) {
+        float s = (float)(i-cell.i0)/(cell.i1-cell.i0);
+        for (int j = cell.j0; j <= cell.j1; j++) {
+            if ((i == cell.i0 || i == cell.i1) && (j == cell.j0 || j == cell.j1))
+                continue;
+            int index = i*columns + j;
+            if (pinned[index])
+                return false;
+            float t = (float)(j-cell.j0)/(cell.j1-cell.j0);
+            float dx = blend(grid.x, s, t) - grid.x[index];
+            float dy = blend(grid.y, s, t) - grid.y[index];
+            float dz = blend(grid.z, s, t) - grid.z[index];
+            if (dx*dx + dy*dy + dz*dz > tolerance*tolerance)
+                return false;
+            if (std::abs(blend(grid.r, s, t) - grid.r[index]) > COLOR_TOLERANCE
+                || std::abs(blend(grid.g, s, t) - grid.g[index]) > COLOR_TOLERANCE
+                || std::abs(blend(grid.b, s, t) - grid.b[index]) > COLOR_TOLERANCE)
+                return false;
         }
+    }
+    return true;
+}
 
-        mesh_.indices[triangle_index] = freckle_position; // Quadrant 1
-        mesh_.indices[triangle_index+1] = freckle_position + 1;
-        mesh_.indices[triangle_index+2] = freckle_position + 2;
+// Halves the cell along every direction wider than one quad until each part fits
+static void split_cell(const PetalGrid& grid, int columns, const GridCell& cell, float tolerance, const std::vector<bool>& pinned, std::vector<GridCell>& leaves) {
+    const bool split_rows = cell.i1 - cell.i0 > 1;
+    const bool split_columns = cell.j1 - cell.j0 > 1;
+    if ((!split_rows && !split_columns) || cell_fits(grid, columns, cell, tolerance, pinned)) {
+        leaves.push_back(cell);
+        return;
+    }
+    const int im = split_rows ? (cell.i0+cell.i1)/2 : cell.i1;
+    const int jm = split_columns ? (cell.j0+cell.j1)/2 : cell.j1;
+    split_cell(grid, columns, {cell.i0, im, cell.j0, jm}, tolerance, pinned, leaves);
+    if (split_columns)
+        split_cell(grid, columns, {cell.i0, im, jm, cell.j1}, tolerance, pinned, leaves);
+    if (split_rows)
+        split_cell(grid, columns, {im, cell.i1, cell.j0, jm}, tolerance, pinned, leaves);
+    if (split_rows && split_columns)
+        split_cell(grid, columns, {im, cell.i1, jm, cell.j1}, tolerance, pinned, leaves);
+}
 
-        mesh_.indices[triangle_index+3] = freckle_position;
-        mesh_.indices[triangle_index+4] = freckle_position + 2;
-        mesh_.indices[triangle_index+5] = freckle_position + 3;
+// Appends the front side triangles of a cell, taking in every kept vertex on its border so the edge vertices
+// of smaller neighbours are shared instead of leaving cracks. The border is split at the first and last corner
+// into a chain over the top and right edges and one over the left and bottom edges, and the two are zipped
+// together in order of distance along the diagonal. No triangle can have all three corners on one edge, so
+// none is degenerate, and without edge vertices this is the cell's two corner triangles.
+static void triangulate_cell(const GridCell& cell, int columns, const std::vector<int>& vertex_of, std::vector<std::array<int,3>>& triangles) {
+    auto kept = [&](int i, int j) {return vertex_of[i*columns + j];};
+    std::vector<int> upper; // top then right edge, without the first and last corner
+    std::vector<float> upper_along;
+    std::vector<int> lower; // left then bottom edge
+    std::vector<float> lower_along;
+    auto along = [&](int i, int j) {return (float)(i-cell.i0)/(cell.i1-cell.i0) + (float)(j-cell.j0)/(cell.j1-cell.j0);};
+    for (int j = cell.j0+1; j <= cell.j1; j++) {
+        if (kept(cell.i0, j) >= 0) {upper.push_back(kept(cell.i0, j)); upper_along.push_back(along(cell.i0, j));}
+    }
+    for (int i = cell.i0+1; i < cell.i1; i++) {
+        if (kept(i, cell.j1) >= 0) {upper.push_back(kept(i, cell.j1)); upper_along.push_back(along(i, cell.j1));}
+    }
+    for (int i = cell.i0+1; i <= cell.i1; i++) {
+        if (kept(i, cell.j0) >= 0) {lower.push_back(kept(i, cell.j0)); lower_along.push_back(along(i, cell.j0));}
+    }
+    for (int j = cell.j0+1; j < cell.j1; j++) {
+        if (kept(cell.i1, j) >= 0) {lower.push_back(kept(cell.i1, j)); lower_along.push_back(along(cell.i1, j));}
+    }
 
-        mesh_.indices[triangle_index+6] = freckle_position; // Quadrant 2
-        mesh_.indices[triangle_index+7] = freckle_position + 3;
-        mesh_.indices[triangle_index+8] = freckle_position + 4;
+    size_t a = 0;
+    size_t b = 0;
+    triangles.push_back({kept(cell.i0, cell.j0), upper[0], lower[0]});
+    while (a + 1 < upper.size() || b + 1 < lower.size()) {
+        if (b + 1 == lower.size() || (a + 1 < upper.size() && upper_along[a+1] <= lower_along[b+1])) {
+            triangles.push_back({upper[a], upper[a+1], lower[b]});
+            a++;
+        } else {
+            triangles.push_back({lower[b], upper[a], lower[b+1]});
+            b++;
+        }
+    }
+    triangles.push_back({upper[a], kept(cell.i1, cell.j1), lower[b]});
+}
 
-        mesh_.indices[triangle_index+9] = freckle_position;
-        mesh_.indices[triangle_index+10] = freckle_position + 4;
-        mesh_.indices[triangle_index+11] = freckle_position + 5;
+// One face of a freckle, an 8 sided ellipse fanned around position. Reversed faces wind the other way.
+static void add_freckle_face(MeshData& data, int& vertex, int& triangle, const PetalKernel& k, Vector3 position, Vector3 normal, bool reversed) {
+    constexpr float ROOT2_2 = 0.7071067811865475244f;
+    const float ELLIPSE_A = k.freckle_size*k.length/100.0f;
+    const float ELLIPSE_B = k.freckle_size*k.width/100.0f;
+
+    Vector3 other = Vector3{0,0,1};
+    Vector3 tangent = Vector3Normalize(Vector3CrossProduct(normal,other));
+    assert((tangent.x != 0.0f || tangent.y != 0.0f || tangent.z != 0.0f));
+    Vector3 binormal = Vector3Normalize(Vector3CrossProduct(normal,tangent));
+
+    const float TANGENT_COMP_X = ELLIPSE_A*ROOT2_2*tangent.x;
+    const float TANGENT_COMP_Y = ELLIPSE_A*ROOT2_2*tangent.y;
+    const float TANGENT_COMP_Z = ELLIPSE_A*ROOT2_2*tangent.z;
+
+    const float BINORMAL_COMP_X = ELLIPSE_B*ROOT2_2*binormal.x;
+    const float BINORMAL_COMP_Y = ELLIPSE_B*ROOT2_2*binormal.y;
+    const float BINORMAL_COMP_Z = ELLIPSE_B*ROOT2_2*binormal.z;
+
+    const int freckle_index = vertex*3;
+    data.vertices[freckle_index] = position.x;
+    data.vertices[freckle_index+1] = position.y;
+    data.vertices[freckle_index+2] = position.z;
+    
+    data.vertices[freckle_index+3] = position.x + ELLIPSE_A*tangent.x; // 0 Degrees
+    data.vertices[freckle_index+4] = position.y + ELLIPSE_A*tangent.y;
+    data.vertices[freckle_index+5] = position.z + ELLIPSE_A*tangent.z;
+
+    data.vertices[freckle_index+6] = position.x + TANGENT_COMP_X + BINORMAL_COMP_X; // 45 Degrees
+    data.vertices[freckle_index+7] = position.y + TANGENT_COMP_Y + BINORMAL_COMP_Y;
+    data.vertices[freckle_index+8] = position.z + TANGENT_COMP_Z + BINORMAL_COMP_Z;
+
+    data.vertices[freckle_index+9] = position.x + ELLIPSE_B*binormal.x; // 90 Degrees
+    data.vertices[freckle_index+10] = position.y + ELLIPSE_B*binormal.y;
+    data.vertices[freckle_index+11] = position.z + ELLIPSE_B*binormal.z;
+
+    data.vertices[freckle_index+12] = position.x - TANGENT_COMP_X + BINORMAL_COMP_X; // 135 Degrees
+    data.vertices[freckle_index+13] = position.y - TANGENT_COMP_Y + BINORMAL_COMP_Y;
+    data.vertices[freckle_index+14] = position.z - TANGENT_COMP_Z + BINORMAL_COMP_Z;
+
+    data.vertices[freckle_index+15] = position.x - ELLIPSE_A*tangent.x; // 180 Degrees
+    data.vertices[freckle_index+16] = position.y - ELLIPSE_A*tangent.y;
+    data.vertices[freckle_index+17] = position.z - ELLIPSE_A*tangent.z;
+
+    data.vertices[freckle_index+18] = position.x - TANGENT_COMP_X - BINORMAL_COMP_X; // 225 Degrees
+    data.vertices[freckle_index+19] = position.y - TANGENT_COMP_Y - BINORMAL_COMP_Y;
+    data.vertices[freckle_index+20] = position.z - TANGENT_COMP_Z - BINORMAL_COMP_Z;
+
+    data.vertices[freckle_index+21] = position.x - ELLIPSE_B*binormal.x; // 270 Degrees
+    data.vertices[freckle_index+22] = position.y - ELLIPSE_B*binormal.y;
+    data.vertices[freckle_index+23] = position.z - ELLIPSE_B*binormal.z;
+
+    data.vertices[freckle_index+24] = position.x + TANGENT_COMP_X - BINORMAL_COMP_X; // 315 Degrees
+    data.vertices[freckle_index+25] = position.y + TANGENT_COMP_Y - BINORMAL_COMP_Y;
+    data.vertices[freckle_index+26] = position.z + TANGENT_COMP_Z - BINORMAL_COMP_Z;
+
+    const int freckle_position = vertex;
+    for (int i = freckle_position; i <= freckle_position + 8; i++) {
+        data.normals[i*3] = normal.x;
+        data.normals[i*3+1] = normal.y;
+        data.normals[i*3+2] = normal.z;
+        data.colors[i*4] = k.freckle.r;
+        data.colors[i*4+1] = k.freckle.g;
+        data.colors[i*4+2] = k.freckle.b;
+        data.colors[i*4+3] = 255;
+    }
+
+    // One triangle per eighth, Quadrant 1 is the first two
+    for (int eighth = 0; eighth < 8; eighth++) {
+        int first = freckle_position + 1 + eighth;
+        int second = freckle_position + 1 + (eighth+1)%8;
+        data.indices[triangle + eighth*3] = freckle_position;
+        data.indices[triangle + eighth*3 + 1] = reversed ? second : first;
+        data.indices[triangle + eighth*3 + 2] = reversed ? first : second;
+    }
 
-        mesh_.indices[triangle_index+12] = freckle_position; // Quadrant 3
-        mesh_.indices[triangle_index+13] = freckle_position + 5;
-        mesh_.indices[triangle_index+14] = freckle_position + 6;
+    vertex += 9;
+    triangle += 24;
+}
 
-        mesh_.indices[triangle_index+15] = freckle_position;
-        mesh_.indices[triangle_index+16] = freckle_position + 6;
-        mesh_.indices[triangle_index+17] = freckle_position + 7;
+// Compact positions are half floats that round by up to 2^-11 at a length of one, for the surface and the
+// freckle alike, so freckles sit further out to stay above it
+static float freckle_offset(const PetalMeshSpec& spec) {
+    return spec.vertex_format == VertexFormat::COMPACT ? 0.002f : 0.0001f; // Prevent Z-fighting
+}
 
-        mesh_.indices[triangle_index+18] = freckle_position; // Quadrant 4
-        mesh_.indices[triangle_index+19] = freckle_position + 7;
-        mesh_.indices[triangle_index+20] = freckle_position + 8;
+constexpr int FRECKLE_VERTICES = 18;
+constexpr int FRECKLE_TRIANGLES = 16;
 
-        mesh_.indices[triangle_index+21] = freckle_position;
-        mesh_.indices[triangle_index+22] = freckle_position + 8;
-        mesh_.indices[triangle_index+23] = freckle_position + 1;
+// Freckles get a face on each side of the surface, offset along the normal both ways. Seen from behind the
+// front face is then covered by the surface and the back face wins the depth test, where a front face alone
+// would z-fight its way through petals drawn without back face culling.
+static void add_freckle(MeshData& data, int& vertex, int& triangle, const PetalKernel& k, const PetalMeshSpec& spec, Vector3 surface, Vector3 normal) {
+    const float offset = freckle_offset(spec);
+    add_freckle_face(data, vertex, triangle, k, Vector3Add(surface, normal*offset), normal, false);
+    add_freckle_face(data, vertex, triangle, k, Vector3Subtract(surface, normal*offset), Vector3Negate(normal), true);
+}
 
-        freckle_index += 27;
-        triangle_index += 24;
+// Adaptive tessellation keeps the full grid only where the surface or its colors bend. Cells are halved
+// until every grid sample inside is within tolerance of the cell's corners, so flat regions become a few
+// large cells while curled edges and color bands keep every sample. Freckle centres are pinned as vertices
+// so freckles still sit exactly on the surface.
+static MeshData build_adaptive_mesh(const PetalMeshSpec& spec, const PetalKernel& k, const PetalGrid& full, const std::vector<std::pair<int,int>>& freckle_positions) {
+    const int columns = k.columns+1;
+    const int full_count = (k.rows+1)*columns;
+    std::vector<bool> pinned(full_count, false);
+    for (auto [row, column] : freckle_positions)
+        pinned[row*columns + column] = true;
+
+    std::vector<GridCell> leaves;
+    split_cell(full, columns, {0, k.rows, 0, k.columns}, spec.tessellation_tolerance, pinned, leaves);
+
+    // Corners of every cell are the surface's vertices, numbered in grid order
+    std::vector<int> vertex_of(full_count, -1);
+    for (const GridCell& cell : leaves) {
+        vertex_of[cell.i0*columns + cell.j0] = 0;
+        vertex_of[cell.i0*columns + cell.j1] = 0;
+        vertex_of[cell.i1*columns + cell.j0] = 0;
+        vertex_of[cell.i1*columns + cell.j1] = 0;
+    }
+    std::vector<int> kept;
+    for (int index = 0; index < full_count; index++) {
+        if (vertex_of[index] == 0) {
+            vertex_of[index] = kept.size();
+            kept.push_back(index);
+        }
+    }
+    std::vector<std::array<int,3>> triangles;
+    for (const GridCell& cell : leaves)
+        triangulate_cell(cell, columns, vertex_of, triangles);
+
+    const int sides = spec.single_sided ? 1 : 2;
+    const int surface_vertices = kept.size();
+    MeshData data;
+    data.resize(surface_vertices*sides + freckle_positions.size()*FRECKLE_VERTICES, triangles.size()*sides + freckle_positions.size()*FRECKLE_TRIANGLES);
+
+    const std::vector<Vector3> front = grid_normals(full, k.rows, columns, false);
+    const std::vector<Vector3> back = spec.single_sided ? std::vector<Vector3>{} : grid_normals(full, k.rows, columns, true);
+    for (int side = 0; side < sides; side++) {
+        const std::vector<Vector3>& normals = side == 0 ? front : back;
+        for (int v = 0; v < surface_vertices; v++) {
+            int index = kept[v];
+            int vertex = side*surface_vertices + v;
+            data.vertices[vertex*3] = full.x[index];
+            data.vertices[vertex*3+1] = full.y[index];
+            data.vertices[vertex*3+2] = full.z[index];
+            data.normals[vertex*3] = normals[index].x;
+            data.normals[vertex*3+1] = normals[index].y;
+            data.normals[vertex*3+2] = normals[index].z;
+            unsigned char color[4] = {(unsigned char)full.r[index], (unsigned char)full.g[index], (unsigned char)full.b[index], 255};
+            std::copy(color, color+4, data.colors.begin() + vertex*4);
+        }
     }
 
-    UploadMesh(&mesh_,false);
-    update_matrix();
+    int triangle_index = 0;
+    for (const auto& [a, b, c] : triangles) {
+        data.indices[triangle_index] = a;
+        data.indices[triangle_index+1] = b;
+        data.indices[triangle_index+2] = c;
+        triangle_index += 3;
+    }
+    if (!spec.single_sided) {
+        // Back side winds the other way
+        for (const auto& [a, b, c] : triangles) {
+            data.indices[triangle_index] = surface_vertices + a;
+            data.indices[triangle_index+1] = surface_vertices + c;
+            data.indices[triangle_index+2] = surface_vertices + b;
+            triangle_index += 3;
+        }
+    }
+
+    int vertex = surface_vertices*sides;
+    for (auto [row, column] : freckle_positions) {
+        int index = row*columns + column;
+        add_freckle(data, vertex, triangle_index, k, spec, full.position(index), front[index]);
+    }
+    return data;
 }
 
-void TaperedPetal::generate_mesh(uint64_t seed) {
-    seed_ = seed;
-    generate_mesh();
+// Matches the old per-vertex evaluation up to float rounding, at most 1 ulp in positions and normals and
+// one step in a color channel where a blend lands on an integer boundary
+MeshData TaperedPetal::build_mesh() const {
+    return build_petal_mesh(mesh_spec(slices_));
 }
 
-std::string TaperedPetal::to_string() const {
-    return "TaperedPetal " +
-    std::to_string(position_.x) + " " + std::to_string(position_.y) + " " + std::to_string(position_.z) + " " +
-    std::to_string(scale_) + " " +
-    std::to_string(quaternion_.x) + " " + std::to_string(quaternion_.y) + " " + std::to_string(quaternion_.z) + " " + std::to_string(quaternion_.w) + " " +
-    std::to_string(seed_) + " (" + 
-    parameter_map_.to_string() + ")";
+MeshData TaperedPetal::build_mesh(std::pair<int,int> slices) const {
+    return build_petal_mesh(mesh_spec(slices));
 }
 
-void TaperedPetal::set_slices(std::pair<int,int> slices) {
-    slices_ = slices;
+// Grid points the freckles sit on, rolled from the seed
+static std::vector<std::pair<int,int>> place_freckles(const PetalKernel& k, uint64_t seed) {
+    std::vector<std::pair<int,int>> freckle_positions {};
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> dist(0.0f,1.0f);
+    for (int i = 0; i <= k.rows; i++) {
+        float u = i*k.u_step;
+        float freckle_chance = k.freckle_amount*std::pow(1.0f-u/(k.length*k.freckle_coverage),k.freckle_centrality);
+        for (int j = 0; j <= k.columns; j++) {
+            float roll = dist(rng);
+            if (i > 1 && j > 1 && j < k.columns-1 && u/k.length < k.freckle_coverage && roll < freckle_chance)
+                freckle_positions.emplace_back(i,j);
+        }
+    }
+    return freckle_positions;
 }
 
-void TaperedPetal::initialize_parameters() {
-    std::mt19937_64 rng(seed_);
-    parameter_map_.set_parameter("Sharpness", Parameter{0.5f,0.75f,1.0f});
-    parameter_map_.seed_gaussian("Sharpness",rng);
+// Writes the full grid normals of both sides into data, returns the front ones for the freckles
+static std::vector<Vector3> write_grid_normals(MeshData& data, const PetalGrid& grid, const PetalKernel& k, bool single_sided) {
+    const std::pair<int,int> grid_slices = {k.rows, k.columns};
+    const int columns = k.columns+1;
+    const int grid_count = (k.rows+1)*columns;
+    const std::vector<Vector3> front = grid_normals(grid, k.rows, columns, false);
+    const std::vector<Vector3> back = single_sided ? std::vector<Vector3>{} : grid_normals(grid, k.rows, columns, true);
+    for (int side = 0; side < (single_sided ? 1 : 2); side++) {
+        const std::vector<Vector3>& normals = side == 0 ? front : back;
+        for (int index = 0; index < grid_count; index++) {
+            int vertex = vertex_index(index/columns, index%columns, grid_slices, side == 1);
+            data.normals[vertex] = normals[index].x;
+            data.normals[vertex+1] = normals[index].y;
+            data.normals[vertex+2] = normals[index].z;
+        }
+    }
+    return front;
+}
 
-    parameter_map_.set_parameter("Length", Parameter{0.1f,0.5f,1.0f});
-    parameter_map_.seed_gaussian("Length",rng);
+static MeshData build_petal_mesh(const PetalMeshSpec& spec) {
+    const PetalKernel k = resolve_kernel(spec.parameters, spec.slices);
+    const std::pair<int,int> grid_slices = {k.rows, k.columns};
+    const int rows = k.rows;
+    const int columns = k.columns+1;
+    const int grid_count = (rows+1)*columns;
+
+    // Full grid positions and colors in SoA form, one row of the petal at a time
+    PetalGrid grid;
+    grid.x.resize(grid_count);
+    grid.y.resize(grid_count);
+    grid.z.resize(grid_count);
+    grid.r.resize(grid_count);
+    grid.g.resize(grid_count);
+    grid.b.resize(grid_count);
+    // Colors are separable, the gradient only depends on u and the bands only on v
+    std::vector<float> border_amount(columns);
+    std::vector<float> stripe_amount(columns);
+    band_weights(k, border_amount.data(), stripe_amount.data());
+    for (int i = 0; i <= rows; i++) {
+        float u = i*k.u_step;
+        int row = i*columns;
+        std::fill(grid.x.begin() + row, grid.x.begin() + row + columns, u);
+        petal_row(k, u, grid.y.data() + row, grid.z.data() + row);
+        row_colors(k, u, border_amount.data(), stripe_amount.data(), columns, grid.r.data() + row, grid.g.data() + row, grid.b.data() + row);
+    }
 
-    parameter_map_.set_parameter("Height", Parameter{0.1f,0.25f,0.5f});
-    parameter_map_.seed_gaussian("Height",rng);
+    const std::vector<std::pair<int,int>> freckle_positions = place_freckles(k, spec.seed);
+    if (spec.tessellation_tolerance > 0.0f)
+        return build_adaptive_mesh(spec, k, grid, freckle_positions);
+
+    const int sides = spec.single_sided ? 1 : 2;
+    int petal_vertex_count = grid_count*sides;
+    int petal_triangle_count = (rows*k.columns)*2*sides;
+
+    int freckle_vertex_count = freckle_positions.size()*FRECKLE_VERTICES;
+    int freckle_triangle_count = freckle_positions.size()*FRECKLE_TRIANGLES;
+
+    MeshData data;
+    data.resize(petal_vertex_count + freckle_vertex_count, petal_triangle_count + freckle_triangle_count);
+
+    for (int i = 0; i <= rows; i++) {
+        for (int j = 0; j < columns; j++) {
+            int index_top = vertex_index(i,j,grid_slices,false);
+            int index_bottom = vertex_index(i,j,grid_slices,true);
+            int index = i*columns + j;
+            data.vertices[index_top] = grid.x[index];
+            data.vertices[index_top+1] = grid.y[index];
+            data.vertices[index_top+2] = grid.z[index];
+            unsigned char color[4] = {(unsigned char)grid.r[index], (unsigned char)grid.g[index], (unsigned char)grid.b[index], 255};
+            std::copy(color, color+4, data.colors.begin() + 4*index_top/3);
+            if (spec.single_sided)
+                continue;
+
+            data.vertices[index_bottom] = grid.x[index];
+            data.vertices[index_bottom+1] = grid.y[index];
+            data.vertices[index_bottom+2] = grid.z[index];
+            std::copy(color, color+4, data.colors.begin() + 4*index_bottom/3);
+        }
+    }
 
-    parameter_map_.set_parameter("Curl", Parameter{1.5f,2.25f,3.0f});
-    parameter_map_.seed_gaussian("Curl",rng);
+    const std::vector<Vector3> front = write_grid_normals(data, grid, k, spec.single_sided);
 
-    parameter_map_.set_parameter("Width", Parameter{0.1f,0.125f,0.25f});
-    parameter_map_.seed_gaussian("Width",rng);
+    int triangle_index = 0;
+    for (int i = 0; i <= rows-1; i++) {
+        for (int j = 0; j <= k.columns-1; j++) {
+            int index = vertex_index(i,j,grid_slices,false);
+            int index_two = vertex_index(i+1,j,grid_slices,false);
+            int index_three = vertex_index(i,j+1,grid_slices,false);
+            int index_four = vertex_index(i+1,j+1,grid_slices,false);
 
-    parameter_map_.set_parameter("Curvature", Parameter{0.1f,0.175f,0.35f});
-    parameter_map_.seed_gaussian("Curvature",rng);
+            data.indices[triangle_index] = index/3;
+            data.indices[triangle_index+1] = index_three/3;
+            data.indices[triangle_index+2] = index_four/3;
 
+            data.indices[triangle_index+3] = index_two/3;
+            data.indices[triangle_index+4] = index/3;
+            data.indices[triangle_index+5] = index_four/3;
 
+            triangle_index += 6;
+            if (spec.single_sided)
+                continue;
 
-    parameter_map_.set_parameter("BaseColor", Parameter{});
-    parameter_map_.seed_hsv_gaussian("BaseColor",270.0f, 430.0f, rng);
+            // Back side
 
-    parameter_map_.set_parameter("BorderWidth", Parameter{0.0f,0.5f,3.0f});
-    parameter_map_.seed_gaussian("BorderWidth",rng);
+            index = vertex_index(i,j,grid_slices,true);
+            index_two = vertex_index(i+1,j,grid_slices,true);
+            index_three = vertex_index(i,j+1,grid_slices,true);
+            index_four = vertex_index(i+1,j+1,grid_slices,true);
 
-    parameter_map_.set_parameter("BorderColor", Parameter{});
-    parameter_map_.seed_hsv_uniform("BorderColor",270.0f, 430.0f, rng);
+            data.indices[triangle_index] = index_three/3;
+            data.indices[triangle_index+1] = index/3;
+            data.indices[triangle_index+2] = index_four/3;
 
-    parameter_map_.set_parameter("GradientWidth", Parameter{0.0f,1.5f,3.0f});
-    parameter_map_.seed_gaussian("GradientWidth",rng);
+            data.indices[triangle_index+3] = index/3;
+            data.indices[triangle_index+4] = index_two/3;
+            data.indices[triangle_index+5] = index_four/3;
 
-    parameter_map_.set_parameter("GradientColor", Parameter{});
-    parameter_map_.seed_hsv_gaussian("GradientColor",270.0f, 430.0f, rng);
+            triangle_index += 6;
+        }
+    }
 
-    parameter_map_.set_parameter("StripeWidth", Parameter{0.0f,0.125f,0.25f});
-    parameter_map_.seed_gaussian("StripeWidth",rng);
+    int vertex = petal_vertex_count;
+    for (auto [row, column] : freckle_positions) {
+        int index = row*columns + column;
+        add_freckle(data, vertex, triangle_index, k, spec, grid.position(index), front[index]);
+    }
+    return data;
+}
 
-    parameter_map_.set_parameter("StripeColor", Parameter{});
-    parameter_map_.seed_hsv_uniform("StripeColor",270.0f, 430.0f, rng);
+// build_mesh with only the freckles redone, in the full grid layout. The surface of the current mesh is kept:
+// positions are read back from its CPU copy, normals worked out from them the way build_mesh does and its surface
+// triangles kept in their order. Returns no vertices if the current mesh is not in this layout.
+MeshData TaperedPetal::rebuild_freckles() const {
+    const PetalMeshSpec spec = mesh_spec(slices_);
+    const PetalKernel k = resolve_kernel(parameter_map_, slices_);
+    const int columns = k.columns+1;
+    const int grid_count = (k.rows+1)*columns;
+    const int sides = single_sided_ ? 1 : 2;
+    const int surface_vertices = grid_count*sides;
+    const int surface_triangles = k.rows*k.columns*2*sides;
+    const int old_freckles = (mesh_->vertexCount - surface_vertices)/FRECKLE_VERTICES;
+    if (mesh_->vertices == nullptr || mesh_->indices == nullptr || old_freckles < 0 ||
+        mesh_->vertexCount != surface_vertices + old_freckles*FRECKLE_VERTICES)
+        return MeshData{};
+
+    PetalGrid grid;
+    grid.x.resize(grid_count);
+    grid.y.resize(grid_count);
+    grid.z.resize(grid_count);
+    for (int index = 0; index < grid_count; index++) {
+        grid.x[index] = mesh_->vertices[index*3];
+        grid.y[index] = mesh_->vertices[index*3+1];
+        grid.z[index] = mesh_->vertices[index*3+2];
+    }
 
-    parameter_map_.set_parameter("FreckleAmount", Parameter{0.0f,0.45f,0.9f});
-    parameter_map_.seed_gaussian("FreckleAmount",rng);
+    const std::vector<std::pair<int,int>> freckle_positions = place_freckles(k, seed_);
+    MeshData data;
+    data.resize(surface_vertices + freckle_positions.size()*FRECKLE_VERTICES, surface_triangles + freckle_positions.size()*FRECKLE_TRIANGLES);
+    std::copy(mesh_->vertices, mesh_->vertices + surface_vertices*3, data.vertices.begin());
+    const std::vector<Vector3> front = write_grid_normals(data, grid, k, single_sided_);
 
-    parameter_map_.set_parameter("FreckleCentrality", Parameter{1.0f,2.0f,4.0f});
-    parameter_map_.seed_gaussian("FreckleCentrality",rng);
+    // Triangles touching only surface vertices, whatever order the vertex cache optimizer left them in
+    int triangle_index = 0;
+    for (int t = 0; t < mesh_->triangleCount; t++) {
+        const unsigned short* triangle = mesh_->indices + t*3;
+        if (triangle[0] >= surface_vertices || triangle[1] >= surface_vertices || triangle[2] >= surface_vertices)
+            continue;
+        if (triangle_index == surface_triangles*3)
+            return MeshData{};
+        std::copy(triangle, triangle+3, data.indices.begin() + triangle_index);
+        triangle_index += 3;
+    }
+    if (triangle_index != surface_triangles*3)
+        return MeshData{};
 
-    parameter_map_.set_parameter("FreckleSize", Parameter{0.1f,1.5f,3.0f});
-    parameter_map_.seed_gaussian("FreckleSize",rng);
+    int vertex = surface_vertices;
+    for (auto [row, column] : freckle_positions) {
+        int index = row*columns + column;
+        add_freckle(data, vertex, triangle_index, k, spec, grid.position(index), front[index]);
+    }
+    data.colors = build_colors(data.vertex_count());
+    // Fans only depend on their place in the freckle list, so with as many freckles as before the old index
+    // buffer is still right and the mesh can be updated in place
+    if ((int)freckle_positions.size() == old_freckles)
+        data.indices.assign(mesh_->indices, mesh_->indices + mesh_->triangleCount*3);
+    return data;
+}
 
-    parameter_map_.set_parameter("FreckleCoverage", Parameter{0.0f,0.6f,0.9f});
-    parameter_map_.seed_gaussian("FreckleCoverage",rng);
+// Vertex colors in build_mesh's full grid layout, adaptive tessellation off. Freckles take the vertices after the
+// petal surface, so the freckle count follows from vertex_count.
+std::vector<unsigned char> TaperedPetal::build_colors(int vertex_count) const {
+    const PetalKernel k = resolve_kernel(parameter_map_, slices_);
+    const std::pair<int,int> grid_slices = {k.rows, k.columns};
+    const int columns = k.columns+1;
+    const int sides = single_sided_ ? 1 : 2;
+    std::vector<unsigned char> colors(vertex_count*4, 255);
+
+    std::vector<float> border_amount(columns);
+    std::vector<float> stripe_amount(columns);
+    std::vector<float> r(columns);
+    std::vector<float> g(columns);
+    std::vector<float> b(columns);
+    band_weights(k, border_amount.data(), stripe_amount.data());
+    for (int i = 0; i <= k.rows; i++) {
+        row_colors(k, i*k.u_step, border_amount.data(), stripe_amount.data(), columns, r.data(), g.data(), b.data());
+        for (int side = 0; side < sides; side++) {
+            for (int j = 0; j < columns; j++) {
+                int index = 4*vertex_index(i,j,grid_slices,side == 1)/3;
+                colors[index] = (unsigned char)r[j];
+                colors[index+1] = (unsigned char)g[j];
+                colors[index+2] = (unsigned char)b[j];
+            }
+        }
+    }
+    for (int i = (k.rows+1)*columns*sides; i < vertex_count; i++) {
+        colors[i*4] = k.freckle.r;
+        colors[i*4+1] = k.freckle.g;
+        colors[i*4+2] = k.freckle.b;
+    }
+    return colors;
+}
 
-    parameter_map_.set_parameter("FreckleColor", Parameter{});
-    parameter_map_.seed_hsv_uniform("FreckleColor",270.0f, 430.0f, rng);
-    
-    parameter_map_.set_parameter("CreaseBoolean", Parameter{0.0f,0.0f,1.0f});
-    
-    parameter_map_.set_parameter("ConcaveBoolean", Parameter{0.0f,0.0f,1.0f});
+void TaperedPetal::generate_mesh(uint64_t seed) {
+    seed_ = seed;
+    generate_mesh();
+}
+
+std::string TaperedPetal::to_string() const {
+    return "TaperedPetal " +
+    std::to_string(position_.x) + " " + std::to_string(position_.y) + " " + std::to_string(position_.z) + " " +
+    std::to_string(scale_) + " " +
+    std::to_string(quaternion_.x) + " " + std::to_string(quaternion_.y) + " " + std::to_string(quaternion_.z) + " " + std::to_string(quaternion_.w) + " " +
+    std::to_string(seed_) + " (" + 
+    parameter_map_.to_string() + ")";
+}
+
+void TaperedPetal::set_default_mesh_options(const PetalMeshOptions& options) {
+    default_mesh_options = options;
+}
+
+const PetalMeshOptions& TaperedPetal::get_default_mesh_options() {
+    return default_mesh_options;
+}
+
+void TaperedPetal::set_slices(std::pair<int,int> slices) {
+    slices_ = slices;
+}
+
+void TaperedPetal::set_tessellation_tolerance(float tolerance) {
+    tessellation_tolerance_ = tolerance;
+}
+
+void TaperedPetal::set_single_sided(bool single_sided) {
+    single_sided_ = single_sided;
+}
+
+bool TaperedPetal::is_single_sided() const {
+    return single_sided_;
+}
+
+void TaperedPetal::set_vertex_format(VertexFormat format) {
+    vertex_format_ = format;
+}
+
+void TaperedPetal::initialize_parameters() {
+    std::mt19937_64 rng(seed_);
+    parameter_map_ = ParameterMap(PETAL_SCHEMA);
+    parameter_map_.seed(rng);
 }
 
 Vector3 TaperedPetal::tip_vector() const {
-    float curl = parameter_map_.get_parameter("Curl").value;
-    float height = parameter_map_.get_parameter("Height").value;
-    float length = parameter_map_.get_parameter("Length").value;
+    float curl = parameter_map_[PetalParameter::CURL].value;
+    float height = parameter_map_[PetalParameter::HEIGHT].value;
+    float length = parameter_map_[PetalParameter::LENGTH].value;
 
     float mid_x = length*curl/3.0f;
     float a = std::sqrtf(height)/mid_x;
@@ -454,38 +1060,11 @@ Vector3 TaperedPetal::tip_vector() const {
     return Vector3{length,2.0f*curl*a*a*length*length/3.0f-a*a*length*length};
 }
 
+// Width across the first row of the grid, one column in from each edge, evaluated without building a mesh
 float TaperedPetal::base_width() const {
-    int index_one = vertex_index(1,0,slices_,false);
-    int index_two = vertex_index(1,slices_.second-1,slices_,false);
-    return mesh_.vertices[index_two+2] - mesh_.vertices[index_one+2];
-}
-
-float TaperedPetal::X(float u, float v) const {
-    return u;
-}
-
-float TaperedPetal::Y(float u, float v) const {
-    bool crease = parameter_map_.get_parameter("CreaseBoolean").value > 0.5f;
-    bool concave = parameter_map_.get_parameter("ConcaveBoolean").value > 0.5f;
-    float length = parameter_map_.get_parameter("Length").value;
-    float height = parameter_map_.get_parameter("Height").value;
-    float width = parameter_map_.get_parameter("Width").value;
-    float curvature = parameter_map_.get_parameter("Curvature").value;
-    if (crease)
-        curvature = std::powf(curvature,2.0f);
-    float curl = parameter_map_.get_parameter("Curl").value;
-    float z = Z(u,v);
-    float midpoint = length*curl/3.0f;
-    float a = std::sqrt(height)/midpoint;
-    float t1 = std::powf((a*(u-midpoint)),2);
-    float t2 = std::abs(std::powf(curvature*z/width,(float)(2-crease)));
-    float t3 = std::powf(midpoint*a,2);
-    return -t1 + (1.0f-2.0f*concave)*t2 + t3;
-}
-
-float TaperedPetal::Z(float u, float v) const {
-    float length = parameter_map_.get_parameter("Length").value;
-    float sharpness = parameter_map_.get_parameter("Sharpness").value;
-    float temp = std::abs(-4.0f*(u-length/2.0f)*(u-length/2.0f)/(length*length)+1);
-    return v * std::powf(temp,1/(4.0f-3.0f*sharpness));
-}
\ No newline at end of file
+    const PetalKernel k = resolve_kernel(parameter_map_, slices_);
+    std::vector<float> ys(k.columns+1);
+    std::vector<float> zs(k.columns+1);
+    petal_row(k, k.u_step, ys.data(), zs.data());
+    return zs[k.columns-1] - zs[0];
+}
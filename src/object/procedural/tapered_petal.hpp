@@ -1,10 +1,93 @@
 #pragma once
+#include <array>
+#include <mutex>
 #include <random>
 #include "object/object3d.hpp"
 #include "object/procedural/parameter.hpp"
+#include "render/lod.hpp"
+#include "render/mesh_data.hpp"
 
 #include "raylib.h"
 
+enum class PetalParameter {
+    SHARPNESS,
+    LENGTH,
+    HEIGHT,
+    CURL,
+    WIDTH,
+    CURVATURE,
+    BASE_COLOR,
+    BORDER_WIDTH,
+    BORDER_COLOR,
+    GRADIENT_WIDTH,
+    GRADIENT_COLOR,
+    STRIPE_WIDTH,
+    STRIPE_COLOR,
+    FRECKLE_AMOUNT,
+    FRECKLE_CENTRALITY,
+    FRECKLE_SIZE,
+    FRECKLE_COVERAGE,
+    FRECKLE_COLOR,
+    CREASE_BOOLEAN,
+    CONCAVE_BOOLEAN,
+    COUNT
+};
+
+inline constexpr std::array<ParameterInfo, (size_t)PetalParameter::COUNT> PETAL_SCHEMA = {{
+    {"Sharpness", {0.5f,0.75f,1.0f}, PARAMETER_EFFECT_GEOMETRY, ParameterSeed::GAUSSIAN},
+    {"Length", {0.1f,0.5f,1.0f}, PARAMETER_EFFECT_GEOMETRY, ParameterSeed::GAUSSIAN},
+    {"Height", {0.1f,0.25f,0.5f}, PARAMETER_EFFECT_GEOMETRY, ParameterSeed::GAUSSIAN},
+    {"Curl", {1.5f,2.25f,3.0f}, PARAMETER_EFFECT_GEOMETRY, ParameterSeed::GAUSSIAN},
+    {"Width", {0.1f,0.125f,0.25f}, PARAMETER_EFFECT_GEOMETRY, ParameterSeed::GAUSSIAN},
+    {"Curvature", {0.1f,0.175f,0.35f}, PARAMETER_EFFECT_GEOMETRY, ParameterSeed::GAUSSIAN},
+    {"BaseColor", {}, PARAMETER_EFFECT_COLOR, ParameterSeed::HSV_GAUSSIAN, 270.0f, 430.0f},
+    {"BorderWidth", {0.0f,0.5f,3.0f}, PARAMETER_EFFECT_COLOR, ParameterSeed::GAUSSIAN},
+    {"BorderColor", {}, PARAMETER_EFFECT_COLOR, ParameterSeed::HSV_UNIFORM, 270.0f, 430.0f},
+    {"GradientWidth", {0.0f,1.5f,3.0f}, PARAMETER_EFFECT_COLOR, ParameterSeed::GAUSSIAN},
+    {"GradientColor", {}, PARAMETER_EFFECT_COLOR, ParameterSeed::HSV_GAUSSIAN, 270.0f, 430.0f},
+    {"StripeWidth", {0.0f,0.125f,0.25f}, PARAMETER_EFFECT_COLOR, ParameterSeed::GAUSSIAN},
+    {"StripeColor", {}, PARAMETER_EFFECT_COLOR, ParameterSeed::HSV_UNIFORM, 270.0f, 430.0f},
+    {"FreckleAmount", {0.0f,0.45f,0.9f}, PARAMETER_EFFECT_FRECKLES, ParameterSeed::GAUSSIAN},
+    {"FreckleCentrality", {1.0f,2.0f,4.0f}, PARAMETER_EFFECT_FRECKLES, ParameterSeed::GAUSSIAN},
+    {"FreckleSize", {0.1f,1.5f,3.0f}, PARAMETER_EFFECT_FRECKLES, ParameterSeed::GAUSSIAN},
+    {"FreckleCoverage", {0.0f,0.6f,0.9f}, PARAMETER_EFFECT_FRECKLES, ParameterSeed::GAUSSIAN},
+    {"FreckleColor", {}, PARAMETER_EFFECT_COLOR, ParameterSeed::HSV_UNIFORM, 270.0f, 430.0f},
+    {"CreaseBoolean", {0.0f,0.0f,1.0f}, PARAMETER_EFFECT_GEOMETRY},
+    {"ConcaveBoolean", {0.0f,0.0f,1.0f}, PARAMETER_EFFECT_GEOMETRY}
+}};
+static_assert(PETAL_SCHEMA.size() <= MAX_PARAMETERS);
+
+// Grid resolution per LOD level, level 0 uses the petal's own slices
+inline constexpr std::array<std::pair<int,int>, LOD_COUNT> LOD_SLICES = {{{40,20}, {16,8}, {6,3}}};
+
+// How this machine builds petal meshes. These are quality settings rather than part of a petal, so they are
+// not saved with it and every petal constructed afterwards starts from them.
+struct PetalMeshOptions {
+    // Largest distance adaptive tessellation may move the surface by merging grid cells, 0 keeps the full grid
+    float tessellation_tolerance = 0.0f;
+    // One copy of the surface drawn without back face culling, instead of a front and a mirrored back copy
+    bool single_sided = false;
+    VertexFormat vertex_format = VertexFormat::FLOAT;
+};
+
+// Every input a petal mesh is built from, copied out of the petal so a worker can build it while the petal
+// stays editable on the main thread
+struct PetalMeshSpec {
+    ParameterMap parameters;
+    uint64_t seed;
+    std::pair<int,int> slices;
+    float tessellation_tolerance;
+    bool single_sided;
+    VertexFormat vertex_format;
+};
+
+// Mesh data built off the main thread and waiting for its upload. Petals preparing the same content at the same
+// time share one and the first to get there builds it.
+struct StagedMesh {
+    std::once_flag built;
+    MeshData data;
+};
+
 class TaperedPetal : public ParameterObject {
 public:
     TaperedPetal();
@@ -13,19 +96,47 @@ public:
     TaperedPetal(ParameterMap map, uint64_t seed, Quaternion quaternion, Vector3 position, float scale);
     TaperedPetal(std::string data);
 
+    static void set_default_mesh_options(const PetalMeshOptions& options);
+    static const PetalMeshOptions& get_default_mesh_options();
+
     void set_slices(std::pair<int,int> slices);
+    void set_tessellation_tolerance(float tolerance);
+    void set_single_sided(bool single_sided);
+    bool is_single_sided() const;
+    void set_vertex_format(VertexFormat format);
+    std::function<void()> mesh_job() override;
     void generate_mesh() override;
     void generate_mesh(uint64_t seed);
+    void update_mesh() override;
+    MeshData build_mesh() const;
+    MeshData build_mesh(std::pair<int,int> slices) const;
+    // The nearest level that is resident, a missing level is queued and drawn once it has been uploaded
+    const std::shared_ptr<const Mesh>& get_lod_mesh(int level) const;
+    void submit(InstanceBatcher& batcher) const override;
+    void submit(InstanceBatcher& batcher, const Matrix& transform) const override;
+    bool is_static_batchable() const override {return false;} // instanced already, and picks its LOD per frame
 
     Vector3 tip_vector() const;
     float base_width() const;
 
     std::string to_string() const override;
 private:
-    float X(float u, float v) const;
-    float Y(float u, float v) const;
-    float Z(float u, float v) const;
+    PetalMeshSpec mesh_spec(std::pair<int,int> slices) const;
+    uint64_t content_hash(std::pair<int,int> slices) const;
+    std::vector<unsigned char> build_colors(int vertex_count) const;
+    MeshData rebuild_freckles() const;
+    void request_lod(int level) const;
     void initialize_parameters() override;
     std::pair<int,int> slices_;
     uint64_t seed_;
+    uint64_t mesh_hash_ = 0; // content hash mesh_ was built for
+    std::shared_ptr<StagedMesh> staged_; // shared with the job mesh_job returned, generate_mesh uploads it
+    uint64_t staged_hash_ = 0;
+    float tessellation_tolerance_ = get_default_mesh_options().tessellation_tolerance;
+    bool single_sided_ = get_default_mesh_options().single_sided;
+    VertexFormat vertex_format_ = get_default_mesh_options().vertex_format;
+    mutable std::array<std::shared_ptr<const Mesh>, LOD_COUNT> lods_; // level 0 is mesh_
+    // Filled on the main thread by the MeshQueue job building the level, picked up into lods_ when next drawn
+    mutable std::array<std::shared_ptr<std::shared_ptr<const Mesh>>, LOD_COUNT> lod_requests_;
+    mutable int lod_level_ = 0;
 };
\ No newline at end of file
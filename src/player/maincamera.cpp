@@ -3,6 +3,9 @@
 #include "player/maincamera.hpp"
 #include <algorithm>
 
+#include "raymath.h"
+#include "rlgl.h"
+
 MainCamera::MainCamera() {
     float mag = sqrt(1+0.3*0.3);
     direction_ = {1.0f/mag, 0.0f, 0.3f/mag};
@@ -80,6 +83,17 @@ const Vector3& MainCamera::get_position() const {
     return camera_.position;
 }
 
+// Same view and projection BeginMode3D builds for a perspective camera
+Frustum MainCamera::get_frustum(float aspect) const {
+    Matrix view = MatrixLookAt(camera_.position, camera_.target, camera_.up);
+    Matrix projection = MatrixPerspective(camera_.fovy*DEG2RAD, aspect, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+    return Frustum(MatrixMultiply(view, projection));
+}
+
+LodView MainCamera::get_lod_view(float screen_height) const {
+    return LodView{camera_.position, screen_height/(2.0f*std::tan(camera_.fovy*DEG2RAD/2.0f))};
+}
+
 int MainCamera::get_mode() const {
     return camera_mode_;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "raylib.h"
 
 #include "player/player.hpp"
+#include "render/frustum.hpp"
+#include "render/lod.hpp"
 
 class MainCamera {
 public:
@@ -14,6 +16,8 @@ public:
     const Camera3D& get_camera() const;
     const Vector3& get_direction() const;
     const Vector3& get_position() const;
+    Frustum get_frustum(float aspect) const;
+    LodView get_lod_view(float screen_height) const;
     int get_mode() const;
 
 private:
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cmath>
@@ -7,12 +8,17 @@
 #include "object/consistent/move_tool.hpp"
 #include "object/consistent/sun_tool.hpp"
 #include "object/consistent/rotate_tool.hpp"
+#include "object/consistent/parameter_tool.hpp"
 #include "object/procedural/tapered_petal.hpp"
 #include "player/player.hpp"
 #include "util.hpp"
 #include "world/world.hpp"
 #include "object/procedural/lily_flower.hpp"
 
+#include "raymath.h"
+
+constexpr float HELD_ITEM_HEIGHT = 2.0f; // above the player's feet
+
 Player::Player(std::string username, Vector3 position) : username_(username), hitbox_({0.0f,0.0f,0.0f}, {1.0f, 2.0f, 1.0f}, 1.0f, WHITE) {
     speed_ = 4.0f;
     pickup_range_ = 3.0f;
@@ -38,6 +44,8 @@ Player::Player(std::string data) : hitbox_({0.0f,0.0f,0.0f}, {1.0f, 2.0f, 1.0f},
             selected_item_ = std::make_shared<SunTool>(split[6]);
         } else if (get_first_word(split[6]) == "RotateTool") {
             selected_item_ = std::make_shared<RotateTool>(split[6]);
+        } else if (get_first_word(split[6]) == "ParameterTool") {
+            selected_item_ = std::make_shared<ParameterTool>(split[6]);
         }
     }
     std::vector<std::string> model_objects = split_string(split[7]);
@@ -58,13 +66,16 @@ Player::~Player() {
     selected_item_previous_shader_.reset();
 }
 
-void Player::draw(std::string current_user, const MainCamera& camera) const {
+// Players are only drawn from a World, after its update_transforms
+void Player::submit(InstanceBatcher& batcher, std::string current_user, const MainCamera& camera) const {
+    assert(transforms_ != nullptr);
     if ((camera.get_mode() != CAMERA_CUSTOM || username_ != current_user) && online_) {
+        const Matrix& root = transforms_->get_world(root_node_);
         for (const auto& object : model_)
-            object->draw_offset(get_position().x, get_position().y, get_position().z);
+            object->submit(batcher, MatrixMultiply(object->get_matrix(), root));
     }
     if (selected_item_ != nullptr && online_) {
-        selected_item_->draw_offset(get_position().x, get_position().y + 2.0f, get_position().z);
+        selected_item_->submit(batcher, MatrixMultiply(selected_item_->get_matrix(), transforms_->get_world(hand_node_)));
     }
 }
 
@@ -83,6 +94,7 @@ bool Player::move(MainCamera& camera, const std::vector<bool>& keybinds, float d
     dz = dz/magnitude*dt*speed_;
 
     hitbox_.set_position(Vector3{hitbox_.get_position().x + dx, hitbox_.get_position().y, hitbox_.get_position().z + dz});
+    update_transform();
     return true;
 }
 
@@ -90,33 +102,64 @@ uint32_t Player::try_pickup(MainCamera& camera, std::shared_ptr<World> world, co
     uint32_t id = 0;
     if (keybinds[9]) {
         Ray ray = Ray{camera.get_position(), camera.get_direction()};
-        float min_distance = std::numeric_limits<float>::infinity();
-        for (const auto& p : world->get_objects()) {
-            std::shared_ptr<Item> item = std::dynamic_pointer_cast<Item>(p.second);
-            if (item == nullptr) {
-                continue;
-            }
-            RayCollision c = GetRayCollisionBox(ray, p.second->get_bounding_box());
-            if (c.hit) {
-                float d = c.distance;
-                if (d < min_distance && d <= pickup_range_) {
-                    id = p.first;
-                    min_distance = d;
-                }
-            }
-        }
+        id = world->raycast(ray, RaycastFilter{OBJECT_MASK_ITEM}, pickup_range_).id;
     }
     return id;
 }
 
 void Player::set_position(Vector3 position) {
     hitbox_.set_position(Vector3{position.x, position.y+0.5f, position.z});
+    update_transform();
+}
+
+void Player::set_network_position(Vector3 position) {
+    const double time = GetTime();
+    interpolate_from_ = shown_position_;
+    interpolation_seconds_ = std::clamp((float)(time - network_time_), 0.0f, MAX_INTERPOLATION_SECONDS);
+    network_time_ = time;
+    hitbox_.set_position(Vector3{position.x, position.y+0.5f, position.z});
+    if (interpolation_seconds_ == 0.0f)
+        update_transform();
+}
+
+void Player::interpolate(double time) {
+    if (interpolation_seconds_ == 0.0f)
+        return;
+    float t = (time - network_time_)/interpolation_seconds_;
+    if (t >= 1.0f) {
+        update_transform();
+        return;
+    }
+    shown_position_ = Vector3Lerp(interpolate_from_, get_position(), t);
+    if (transforms_ != nullptr)
+        transforms_->set_local(root_node_, MatrixTranslate(shown_position_.x, shown_position_.y, shown_position_.z));
+}
+
+// Snaps the model to the hitbox, ending any interpolation
+void Player::update_transform() {
+    shown_position_ = get_position();
+    interpolation_seconds_ = 0.0f;
+    if (transforms_ != nullptr)
+        transforms_->set_local(root_node_, MatrixTranslate(shown_position_.x, shown_position_.y, shown_position_.z));
 }
 
 void Player::add_to_model(std::unique_ptr<Object3d>&& object) {
     model_.push_back(std::move(object));
 }
 
+void Player::set_transform_store(TransformStore* store) {
+    if (transforms_ != nullptr)
+        transforms_->remove(root_node_);
+    transforms_ = store;
+    if (transforms_ == nullptr) {
+        root_node_ = TRANSFORM_NONE;
+        hand_node_ = TRANSFORM_NONE;
+        return;
+    }
+    root_node_ = transforms_->add(TRANSFORM_NONE, MatrixTranslate(shown_position_.x, shown_position_.y, shown_position_.z));
+    hand_node_ = transforms_->add(root_node_, MatrixTranslate(0.0f, HELD_ITEM_HEIGHT, 0.0f));
+}
+
 void Player::set_shader(std::shared_ptr<Shader> shader) {
     shader_ = shader;
     for (auto& object : model_) {
@@ -218,7 +261,7 @@ const Cube& Player::get_hitbox() {
     return hitbox_;
 }
 
-std::string Player::get_username() {
+const std::string& Player::get_username() const {
     return username_;
 }
 
@@ -10,20 +10,29 @@
 #include "object/consistent/cube.hpp"
 #include "event/event.hpp"
 #include "object/object3d.hpp"
+#include "world/transform_store.hpp"
 
 class World;
 class MainCamera;
 
+constexpr float MAX_INTERPOLATION_SECONDS = 0.25f; // longest gap between network updates that is smoothed over
+
 class Player : public std::enable_shared_from_this<Player> {
 public:
     Player(std::string username, Vector3 position);
     Player(std::string data);
     ~Player();
 
-    void draw(std::string current_user, const MainCamera& camera) const;
+    void submit(InstanceBatcher& batcher, std::string current_user, const MainCamera& camera) const;
     bool move(MainCamera& camera, const std::vector<bool>& keybinds, float dt);
     void set_position(Vector3 position);
+    // Positions received from the network are eased into over the time since the previous one instead of
+    // jumping with every packet
+    void set_network_position(Vector3 position);
+    void interpolate(double time);
     void add_to_model(std::unique_ptr<Object3d>&& object);
+    // Gives the player a node in the World's store with one for the held item under it, null lets go of them
+    void set_transform_store(TransformStore* store);
     void set_shader(std::shared_ptr<Shader> shader);
     std::shared_ptr<Shader> get_shader() const;
 
@@ -38,13 +47,15 @@ public:
     void on_disconnect();
     bool is_online() const;
 
-    std::string get_username();
+    const std::string& get_username() const;
     const Cube& get_hitbox();
     Vector3 get_position() const;
 
     std::string to_string() const;
     
 private:
+    void update_transform();
+
     std::string username_;
     float speed_;
     float pickup_range_;
@@ -52,7 +63,15 @@ private:
 
     Cube hitbox_;
     std::shared_ptr<Shader> shader_;
-    std::vector<std::unique_ptr<Object3d>> model_;
+    std::vector<std::unique_ptr<Object3d>> model_; // drawn with their own matrices under the player's
+    // The root follows the shown position, the held item hangs off the hand under it
+    TransformStore* transforms_ = nullptr;
+    int32_t root_node_ = TRANSFORM_NONE;
+    int32_t hand_node_ = TRANSFORM_NONE;
+    Vector3 shown_position_ {}; // where the model is drawn, trails the hitbox while interpolating
+    Vector3 interpolate_from_ {};
+    double network_time_ = 0.0; // when the last network position arrived
+    float interpolation_seconds_ = 0.0f; // 0 when not interpolating
     std::shared_ptr<Item> selected_item_;
     std::shared_ptr<Shader> selected_item_previous_shader_;
 };
\ No newline at end of file
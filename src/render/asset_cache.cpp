@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "render/asset_cache.hpp"
+#include "rlgl.h"
+#include "util.hpp"
+
+static std::unordered_map<uint64_t, std::weak_ptr<const Mesh>> meshes;
+static std::unordered_map<uint64_t, std::weak_ptr<Material>> materials;
+// Materials are made on worker threads while objects load there, and workers ask contains_mesh. Everything
+// that can upload or unload a mesh asserts it is on the main thread.
+static std::mutex cache_mutex;
+// Expired entries are swept once a map doubles in size, sweeping on every insert made loading quadratic
+static size_t mesh_sweep_size = 64;
+static size_t material_sweep_size = 64;
+
+template<typename Map>
+static void sweep_expired(Map& map, size_t& sweep_size) {
+    if (map.size() < sweep_size)
+        return;
+    std::erase_if(map, [](const auto& p) {return p.second.expired();});
+    sweep_size = std::max<size_t>(64, map.size()*2);
+}
+
+std::shared_ptr<const Mesh> make_shared_mesh(Mesh mesh) {
+    return std::shared_ptr<const Mesh>(
+        new Mesh(mesh),
+        [](const Mesh* m) {
+            UnloadMesh(*m);
+            delete m;
+        }
+    );
+}
+
+static std::shared_ptr<const Mesh> get_or_generate(const std::string& recipe, const std::function<Mesh()>& generate) {
+    assert(is_main_thread());
+    uint64_t hash = hash_fnv1a(recipe.data(), recipe.size());
+    std::shared_ptr<const Mesh> mesh = AssetCache::find_mesh(hash);
+    if (mesh != nullptr)
+        return mesh;
+    return AssetCache::insert_mesh(hash, generate());
+}
+
+std::shared_ptr<const Mesh> AssetCache::cube(Vector3 size) {
+    return get_or_generate("Cube " + std::to_string(size.x) + " " + std::to_string(size.y) + " " + std::to_string(size.z),
+        [&]() {return GenMeshCube(size.x, size.y, size.z);});
+}
+
+std::shared_ptr<const Mesh> AssetCache::cylinder(float radius, float height, int slices) {
+    return get_or_generate("Cylinder " + std::to_string(radius) + " " + std::to_string(height) + " " + std::to_string(slices),
+        [&]() {return GenMeshCylinder(radius, height, slices);});
+}
+
+std::shared_ptr<const Mesh> AssetCache::sphere(float radius, int rings, int slices) {
+    return get_or_generate("Sphere " + std::to_string(radius) + " " + std::to_string(rings) + " " + std::to_string(slices),
+        [&]() {return GenMeshSphere(radius, rings, slices);});
+}
+
+std::shared_ptr<const Mesh> AssetCache::find_mesh(uint64_t content_hash) {
+    assert(is_main_thread());
+    std::lock_guard lock(cache_mutex);
+    auto it = meshes.find(content_hash);
+    if (it == meshes.end())
+        return nullptr;
+    return it->second.lock();
+}
+
+bool AssetCache::contains_mesh(uint64_t content_hash) {
+    std::lock_guard lock(cache_mutex);
+    auto it = meshes.find(content_hash);
+    return it != meshes.end() && !it->second.expired();
+}
+
+std::shared_ptr<const Mesh> AssetCache::insert_mesh(uint64_t content_hash, Mesh mesh) {
+    assert(is_main_thread());
+    std::lock_guard lock(cache_mutex);
+    sweep_expired(meshes, mesh_sweep_size);
+    std::shared_ptr<const Mesh> shared = make_shared_mesh(mesh);
+    meshes[content_hash] = shared;
+    return shared;
+}
+
+bool AssetCache::update_mesh(const std::shared_ptr<const Mesh>& mesh, uint64_t old_hash, uint64_t new_hash, const MeshData& data, uint32_t streams, VertexFormat format) {
+    assert(is_main_thread());
+    if (mesh == nullptr || mesh.use_count() != 1)
+        return false;
+    update_mesh_streams(*mesh, data, streams, format);
+    std::lock_guard lock(cache_mutex);
+    auto it = meshes.find(old_hash);
+    if (it != meshes.end() && it->second.lock() == mesh)
+        meshes.erase(it);
+    meshes[new_hash] = mesh;
+    return true;
+}
+
+std::shared_ptr<Material> AssetCache::material(Color color, Shader shader) {
+    uint64_t key = ((uint64_t)shader.id << 32) | ((uint64_t)color.r << 24) | ((uint64_t)color.g << 16) | ((uint64_t)color.b << 8) | color.a;
+    std::lock_guard lock(cache_mutex);
+    auto it = materials.find(key);
+    if (it != materials.end()) {
+        if (std::shared_ptr<Material> material = it->second.lock())
+            return material;
+    }
+    sweep_expired(materials, material_sweep_size);
+    std::shared_ptr<Material> material = std::shared_ptr<Material>(
+        new Material(LoadMaterialDefault()),
+        [](Material* m) {
+            RL_FREE(m->maps);
+            delete m;
+        }
+    );
+    material->shader = shader;
+    material->maps[MATERIAL_MAP_DIFFUSE].color = color;
+    materials[key] = material;
+    return material;
+}
+
+std::shared_ptr<Material> AssetCache::material(Color color) {
+    return material(color, Shader{rlGetShaderIdDefault(), rlGetShaderLocsDefault()});
+}
+
+int AssetCache::mesh_count() {
+    std::lock_guard lock(cache_mutex);
+    return std::count_if(meshes.begin(), meshes.end(), [](const auto& p) {return !p.second.expired();});
+}
+
+int AssetCache::material_count() {
+    std::lock_guard lock(cache_mutex);
+    return std::count_if(materials.begin(), materials.end(), [](const auto& p) {return !p.second.expired();});
+}
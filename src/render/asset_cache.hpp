@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+#include "raylib.h"
+
+#include "render/mesh_data.hpp"
+
+// Takes ownership of an uploaded mesh, unloading it once the last holder lets go
+std::shared_ptr<const Mesh> make_shared_mesh(Mesh mesh);
+
+// Process-wide flyweight registry of GPU meshes and materials keyed by a hash of how they were made. Handles
+// are immutable to everyone but a sole owner and entries are weak, so an asset is unloaded as soon as the
+// last object referencing it is destroyed and memory scales with unique geometry rather than object count.
+// Meshes are main thread only, materials and contains_mesh can be used from any thread.
+class AssetCache {
+public:
+    static std::shared_ptr<const Mesh> cube(Vector3 size);
+    static std::shared_ptr<const Mesh> cylinder(float radius, float height, int slices);
+    static std::shared_ptr<const Mesh> sphere(float radius, int rings, int slices);
+
+    static std::shared_ptr<const Mesh> find_mesh(uint64_t content_hash);
+    // Safe off the main thread, unlike find_mesh it never hands out a handle whose release could unload a mesh
+    static bool contains_mesh(uint64_t content_hash);
+    static std::shared_ptr<const Mesh> insert_mesh(uint64_t content_hash, Mesh mesh);
+    // Rewrites streams of a mesh in place and files it under its new hash, only if mesh is its sole handle.
+    // Returns false otherwise, the caller then uploads a new mesh so nobody sharing the old one sees it change.
+    static bool update_mesh(const std::shared_ptr<const Mesh>& mesh, uint64_t old_hash, uint64_t new_hash, const MeshData& data, uint32_t streams, VertexFormat format);
+
+    static std::shared_ptr<Material> material(Color color, Shader shader);
+    static std::shared_ptr<Material> material(Color color);
+
+    static int mesh_count();
+    static int material_count();
+};
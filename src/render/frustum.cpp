@@ -0,0 +1,58 @@
+#include <cmath>
+
+#include "render/frustum.hpp"
+
+Frustum::Frustum() : planes_{} {}
+
+// Gribb/Hartmann extraction, raylib matrices store the first row in m0, m4, m8, m12
+Frustum::Frustum(Matrix m) {
+    const Vector4 row0 = {m.m0, m.m4, m.m8, m.m12};
+    const Vector4 row1 = {m.m1, m.m5, m.m9, m.m13};
+    const Vector4 row2 = {m.m2, m.m6, m.m10, m.m14};
+    const Vector4 row3 = {m.m3, m.m7, m.m11, m.m15};
+    planes_[0] = Vector4{row3.x + row0.x, row3.y + row0.y, row3.z + row0.z, row3.w + row0.w}; // Left
+    planes_[1] = Vector4{row3.x - row0.x, row3.y - row0.y, row3.z - row0.z, row3.w - row0.w}; // Right
+    planes_[2] = Vector4{row3.x + row1.x, row3.y + row1.y, row3.z + row1.z, row3.w + row1.w}; // Bottom
+    planes_[3] = Vector4{row3.x - row1.x, row3.y - row1.y, row3.z - row1.z, row3.w - row1.w}; // Top
+    planes_[4] = Vector4{row3.x + row2.x, row3.y + row2.y, row3.z + row2.z, row3.w + row2.w}; // Near
+    planes_[5] = Vector4{row3.x - row2.x, row3.y - row2.y, row3.z - row2.z, row3.w - row2.w}; // Far
+    for (Vector4& plane : planes_) {
+        float length = std::sqrt(plane.x*plane.x + plane.y*plane.y + plane.z*plane.z);
+        if (length > 0.0f) {
+            plane.x /= length;
+            plane.y /= length;
+            plane.z /= length;
+            plane.w /= length;
+        }
+    }
+}
+
+FrustumTest Frustum::test(const BoundingBox& box) const {
+    FrustumTest result = FrustumTest::INSIDE;
+    for (const Vector4& plane : planes_) {
+        // Corner furthest along the plane normal decides outside, the nearest one decides fully inside
+        float far_distance = plane.x*(plane.x >= 0.0f ? box.max.x : box.min.x) +
+                             plane.y*(plane.y >= 0.0f ? box.max.y : box.min.y) +
+                             plane.z*(plane.z >= 0.0f ? box.max.z : box.min.z) + plane.w;
+        if (far_distance < 0.0f)
+            return FrustumTest::OUTSIDE;
+        float near_distance = plane.x*(plane.x >= 0.0f ? box.min.x : box.max.x) +
+                              plane.y*(plane.y >= 0.0f ? box.min.y : box.max.y) +
+                              plane.z*(plane.z >= 0.0f ? box.min.z : box.max.z) + plane.w;
+        if (near_distance < 0.0f)
+            result = FrustumTest::INTERSECTS;
+    }
+    return result;
+}
+
+bool Frustum::contains(const BoundingBox& box) const {
+    return test(box) != FrustumTest::OUTSIDE;
+}
+
+bool Frustum::contains(Vector3 point) const {
+    for (const Vector4& plane : planes_) {
+        if (plane.x*point.x + plane.y*point.y + plane.z*point.z + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <array>
+
+#include "raylib.h"
+
+enum class FrustumTest {
+    OUTSIDE,
+    INTERSECTS,
+    INSIDE
+};
+
+// Six clip planes (normal xyz, distance w) pointing into the view volume. Pure math, no GL state.
+class Frustum {
+public:
+    Frustum();
+    Frustum(Matrix view_projection);
+
+    FrustumTest test(const BoundingBox& box) const;
+    bool contains(const BoundingBox& box) const;
+    bool contains(Vector3 point) const;
+private:
+    std::array<Vector4,6> planes_;
+};
@@ -0,0 +1,77 @@
+#include "render/instance_batcher.hpp"
+
+InstanceBatcher::InstanceBatcher(std::shared_ptr<Shader> shader) : shader_(std::move(shader)), material_(LoadMaterialDefault()), view_{}, draw_calls_(0), instances_(0), triangles_(0) {
+    material_.shader = *shader_;
+}
+
+InstanceBatcher::~InstanceBatcher() {
+    RL_FREE(material_.maps);
+}
+
+void InstanceBatcher::begin(const LodView& view) {
+    view_ = view;
+    queue_.begin(view.position);
+    draw_calls_ = 0;
+    instances_ = 0;
+    triangles_ = 0;
+}
+
+void InstanceBatcher::add(const std::shared_ptr<const Mesh>& mesh, const Matrix& transform, bool cull_back_faces) {
+    if (mesh == nullptr)
+        return;
+    Batch& batch = batches_[mesh.get()];
+    if (batch.mesh == nullptr)
+        batch.mesh = mesh;
+    batch.cull_back_faces = cull_back_faces;
+    batch.transforms.push_back(transform);
+}
+
+void InstanceBatcher::add_draw(const Mesh& mesh, const Material& material, const Matrix& transform, bool cull_back_faces) {
+    queue_.add(mesh, material, transform, cull_back_faces);
+    draw_calls_++;
+    triangles_ += mesh.triangleCount;
+}
+
+void InstanceBatcher::flush() {
+    for (auto it = batches_.begin(); it != batches_.end();) {
+        Batch& batch = it->second;
+        // Batches nobody submitted to this frame are dropped
+        if (batch.transforms.empty()) {
+            it = batches_.erase(it);
+            continue;
+        }
+        queue_.add_instanced(*batch.mesh, material_, batch.transforms.data(), batch.transforms.size(), batch.cull_back_faces);
+        draw_calls_++;
+        instances_ += batch.transforms.size();
+        triangles_ += batch.mesh->triangleCount*batch.transforms.size();
+        it++;
+    }
+    queue_.flush();
+
+    for (auto& [mesh, batch] : batches_) {
+        batch.transforms.clear();
+        // Only the transform storage is kept between frames, holding the mesh would stop its owner from
+        // updating it in place
+        batch.mesh.reset();
+    }
+}
+
+const LodView& InstanceBatcher::get_view() const {
+    return view_;
+}
+
+int InstanceBatcher::get_draw_calls() const {
+    return draw_calls_;
+}
+
+int InstanceBatcher::get_instances() const {
+    return instances_;
+}
+
+int InstanceBatcher::get_triangles() const {
+    return triangles_;
+}
+
+const RenderQueueStats& InstanceBatcher::get_queue_stats() const {
+    return queue_.get_stats();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "raylib.h"
+
+#include "render/lod.hpp"
+#include "render/render_queue.hpp"
+
+// Collects a frame's draws. Transforms added per shared mesh become one DrawMeshInstanced call each, single
+// draws go in as they are, and everything is submitted through a RenderQueue sorted by GL state.
+class InstanceBatcher {
+public:
+    InstanceBatcher(std::shared_ptr<Shader> shader);
+    ~InstanceBatcher();
+    InstanceBatcher(const InstanceBatcher&) = delete;
+    InstanceBatcher& operator=(const InstanceBatcher&) = delete;
+
+    void begin(const LodView& view);
+    // Meshes added with cull_back_faces false are drawn with culling disabled, for single sided surfaces
+    void add(const std::shared_ptr<const Mesh>& mesh, const Matrix& transform, bool cull_back_faces = true);
+    // A plain DrawMesh with the object's own material, for meshes that are not instanced
+    void add_draw(const Mesh& mesh, const Material& material, const Matrix& transform, bool cull_back_faces = true);
+    void flush();
+
+    const LodView& get_view() const;
+    int get_draw_calls() const;
+    int get_instances() const;
+    int get_triangles() const;
+    const RenderQueueStats& get_queue_stats() const;
+private:
+    struct Batch {
+        std::shared_ptr<const Mesh> mesh;
+        std::vector<Matrix> transforms;
+        bool cull_back_faces = true;
+    };
+
+    std::shared_ptr<Shader> shader_;
+    Material material_;
+    std::unordered_map<const Mesh*, Batch> batches_;
+    RenderQueue queue_;
+    LodView view_;
+    int draw_calls_;
+    int instances_;
+    int triangles_;
+};
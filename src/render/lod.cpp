@@ -0,0 +1,20 @@
+#include <algorithm>
+
+#include "render/lod.hpp"
+#include "raymath.h"
+
+float screen_size(const LodView& view, const BoundingBox& box) {
+    Vector3 center = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+    float radius = Vector3Distance(box.min, box.max)*0.5f;
+    float distance = std::max(Vector3Distance(view.position, center), 0.001f);
+    return radius*view.projection_scale/distance;
+}
+
+int select_lod(float screen_size, int current) {
+    int level = std::clamp(current, 0, LOD_COUNT-1);
+    while (level > 0 && screen_size > LOD_THRESHOLDS[level-1]*(1.0f+LOD_HYSTERESIS))
+        level--;
+    while (level < LOD_COUNT-1 && screen_size < LOD_THRESHOLDS[level]*(1.0f-LOD_HYSTERESIS))
+        level++;
+    return level;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <array>
+
+#include "raylib.h"
+
+constexpr int LOD_COUNT = 3;
+// Projected radius in pixels below which each level hands over to the next coarser one
+constexpr std::array<float, LOD_COUNT-1> LOD_THRESHOLDS = {80.0f, 25.0f};
+// Fraction a size must cross past a threshold before switching, so objects near it do not flicker
+constexpr float LOD_HYSTERESIS = 0.15f;
+
+// What LOD selection needs from the camera for one frame
+struct LodView {
+    Vector3 position;
+    float projection_scale; // pixels covered by one unit at a distance of one unit
+};
+
+float screen_size(const LodView& view, const BoundingBox& box);
+int select_lod(float screen_size, int current);
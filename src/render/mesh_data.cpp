@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "render/mesh_data.hpp"
+#include "raymath.h"
+#include "rlgl.h"
+
+// rlgl only names the types raylib itself uploads
+constexpr int GL_HALF_FLOAT_TYPE = 0x140B;
+constexpr int GL_INT_2_10_10_10_REV_TYPE = 0x8D9F;
+// MAX_MESH_VERTEX_BUFFERS in rmodels.c, UnloadMesh releases that many buffer ids
+constexpr int MESH_VERTEX_BUFFERS = 9;
+
+static MeshUploadStats upload_stats;
+
+void MeshData::resize(int vertex_count, int triangle_count) {
+    vertices.assign(vertex_count*3, 0.0f);
+    normals.assign(vertex_count*3, 0.0f);
+    colors.assign(vertex_count*4, 0);
+    indices.assign(triangle_count*3, 0);
+}
+
+BoundingBox MeshData::get_bounding_box() const {
+    if (vertices.empty())
+        return BoundingBox{Vector3{0,0,0}, Vector3{0,0,0}};
+    Vector3 min_vertex = Vector3{vertices[0], vertices[1], vertices[2]};
+    Vector3 max_vertex = min_vertex;
+    for (size_t i = 3; i < vertices.size(); i += 3) {
+        Vector3 vertex = {vertices[i], vertices[i+1], vertices[i+2]};
+        min_vertex = Vector3Min(min_vertex, vertex);
+        max_vertex = Vector3Max(max_vertex, vertex);
+    }
+    return BoundingBox{min_vertex, max_vertex};
+}
+
+template<typename T>
+static T* copy_array(const std::vector<T>& source) {
+    if (source.empty())
+        return nullptr;
+    T* copy = (T*)MemAlloc(source.size()*sizeof(T));
+    std::memcpy(copy, source.data(), source.size()*sizeof(T));
+    return copy;
+}
+
+// Round to nearest even, petal coordinates never come near the half float overflow
+static uint16_t float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent >= 31)
+        return sign | 0x7c00;
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            half++;
+        return sign | half;
+    }
+    uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++; // a carry out of the mantissa correctly bumps the exponent
+    return half;
+}
+
+static uint32_t pack_snorm10(float value) {
+    return (uint32_t)(int)std::round(std::clamp(value, -1.0f, 1.0f)*511.0f) & 0x3ff;
+}
+
+static std::vector<uint16_t> compact_positions(const MeshData& data) {
+    std::vector<uint16_t> positions(data.vertex_count()*4);
+    for (int i = 0; i < data.vertex_count(); i++) {
+        positions[i*4] = float_to_half(data.vertices[i*3]);
+        positions[i*4+1] = float_to_half(data.vertices[i*3+1]);
+        positions[i*4+2] = float_to_half(data.vertices[i*3+2]);
+        positions[i*4+3] = float_to_half(1.0f); // pads each position to 8 bytes
+    }
+    return positions;
+}
+
+static std::vector<uint32_t> compact_normals(const MeshData& data) {
+    std::vector<uint32_t> normals(data.normals.size()/3);
+    for (size_t i = 0; i < normals.size(); i++)
+        normals[i] = pack_snorm10(data.normals[i*3]) | pack_snorm10(data.normals[i*3+1]) << 10 | pack_snorm10(data.normals[i*3+2]) << 20;
+    return normals;
+}
+
+static bool supports_compact() {
+    int version = rlGetVersion();
+    return version != RL_OPENGL_11 && version != RL_OPENGL_21 && version != RL_OPENGL_ES_20;
+}
+
+static Mesh upload_compact(const MeshData& data) {
+    const int vertex_count = data.vertex_count();
+    std::vector<uint16_t> positions = compact_positions(data);
+    std::vector<uint32_t> normals = compact_normals(data);
+
+    // Same buffer slots and attribute locations UploadMesh uses, so DrawMesh, DrawMeshInstanced and
+    // UnloadMesh treat the mesh like any other. Bounding boxes still read the float positions.
+    Mesh mesh = Mesh{0};
+    mesh.vertexCount = vertex_count;
+    mesh.triangleCount = data.triangle_count();
+    mesh.vertices = copy_array(data.vertices);
+    mesh.indices = copy_array(data.indices);
+    mesh.vboId = (unsigned int*)RL_CALLOC(MESH_VERTEX_BUFFERS, sizeof(unsigned int));
+    mesh.vaoId = rlLoadVertexArray();
+    rlEnableVertexArray(mesh.vaoId);
+
+    mesh.vboId[RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION] = rlLoadVertexBuffer(positions.data(), positions.size()*sizeof(uint16_t), false);
+    rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, 4, GL_HALF_FLOAT_TYPE, false, 0, 0);
+    rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION);
+
+    float texcoord[2] = {0.0f, 0.0f};
+    rlSetVertexAttributeDefault(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD, texcoord, RL_SHADER_ATTRIB_VEC2, 1);
+    rlDisableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD);
+
+    mesh.vboId[RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL] = rlLoadVertexBuffer(normals.data(), normals.size()*sizeof(uint32_t), false);
+    rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL, 4, GL_INT_2_10_10_10_REV_TYPE, true, 0, 0);
+    rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL);
+
+    mesh.vboId[RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR] = rlLoadVertexBuffer(data.colors.data(), data.colors.size(), false);
+    rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, 4, RL_UNSIGNED_BYTE, true, 0, 0);
+    rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR);
+
+    mesh.vboId[RL_DEFAULT_SHADER_ATTRIB_LOCATION_INDICES] = rlLoadVertexBufferElement(data.indices.data(), data.indices.size()*sizeof(unsigned short), false);
+    rlDisableVertexArray();
+    return mesh;
+}
+
+size_t gpu_bytes(const MeshData& data, VertexFormat format) {
+    // UploadMesh also allocates a texcoord buffer for meshes without texcoords
+    size_t vertex_bytes = format == VertexFormat::COMPACT ? 8 + 4 + 4 : 12 + 8 + 12 + 4;
+    return data.vertex_count()*vertex_bytes + data.indices.size()*sizeof(unsigned short);
+}
+
+static void count_upload(const MeshData& data, VertexFormat format) {
+    upload_stats.meshes++;
+    upload_stats.bytes += gpu_bytes(data, format);
+    upload_stats.triangles += data.triangle_count();
+    if (data.cache_miss_ratio >= 0.0f) {
+        upload_stats.measured_triangles += data.triangle_count();
+        upload_stats.cache_misses += std::lround(data.cache_miss_ratio*data.triangle_count());
+    }
+}
+
+const MeshUploadStats& get_upload_stats() {
+    return upload_stats;
+}
+
+Mesh upload_mesh(const MeshData& data, VertexFormat format) {
+    if (format == VertexFormat::COMPACT && supports_compact()) {
+        count_upload(data, VertexFormat::COMPACT);
+        return upload_compact(data);
+    }
+    count_upload(data, VertexFormat::FLOAT);
+    Mesh mesh = Mesh{0};
+    mesh.vertexCount = data.vertex_count();
+    mesh.triangleCount = data.triangle_count();
+    mesh.vertices = copy_array(data.vertices);
+    mesh.normals = copy_array(data.normals);
+    mesh.colors = copy_array(data.colors);
+    mesh.indices = copy_array(data.indices);
+    UploadMesh(&mesh, false);
+    return mesh;
+}
+
+void update_mesh_streams(const Mesh& mesh, const MeshData& data, uint32_t streams, VertexFormat format) {
+    const bool compact = format == VertexFormat::COMPACT && supports_compact();
+    if (streams & MESH_STREAM_POSITIONS) {
+        if (compact) {
+            std::vector<uint16_t> positions = compact_positions(data);
+            UpdateMeshBuffer(mesh, RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, positions.data(), positions.size()*sizeof(uint16_t), 0);
+        } else {
+            UpdateMeshBuffer(mesh, RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, data.vertices.data(), data.vertices.size()*sizeof(float), 0);
+        }
+        if (mesh.vertices != nullptr)
+            std::memcpy(mesh.vertices, data.vertices.data(), data.vertices.size()*sizeof(float));
+    }
+    if (streams & MESH_STREAM_NORMALS) {
+        if (compact) {
+            std::vector<uint32_t> normals = compact_normals(data);
+            UpdateMeshBuffer(mesh, RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL, normals.data(), normals.size()*sizeof(uint32_t), 0);
+        } else {
+            UpdateMeshBuffer(mesh, RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL, data.normals.data(), data.normals.size()*sizeof(float), 0);
+        }
+        if (mesh.normals != nullptr)
+            std::memcpy(mesh.normals, data.normals.data(), data.normals.size()*sizeof(float));
+    }
+    if (streams & MESH_STREAM_COLORS) {
+        UpdateMeshBuffer(mesh, RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, data.colors.data(), data.colors.size(), 0);
+        if (mesh.colors != nullptr)
+            std::memcpy(mesh.colors, data.colors.data(), data.colors.size());
+    }
+}
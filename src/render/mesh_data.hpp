@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "raylib.h"
+
+// CPU-side geometry with one array per attribute, laid out the way raylib uploads it. Building one needs
+// no GL context, so generators can run headless or off the main thread and upload later.
+struct MeshData {
+    std::vector<float> vertices; // xyz per vertex
+    std::vector<float> normals; // xyz per vertex
+    std::vector<unsigned char> colors; // rgba per vertex
+    std::vector<unsigned short> indices; // 3 per triangle
+    float cache_miss_ratio = -1.0f; // average_cache_miss_ratio, measured where the mesh is built, negative if not
+
+    void resize(int vertex_count, int triangle_count);
+    int vertex_count() const {return vertices.size()/3;}
+    int triangle_count() const {return indices.size()/3;}
+    BoundingBox get_bounding_box() const;
+};
+
+// Attribute layout on the GPU. COMPACT stores half float positions and 10-10-10-2 normals next to the RGBA8
+// colors, 16 bytes per vertex instead of 36, and only keeps positions and indices on the CPU side.
+enum class VertexFormat {FLOAT, COMPACT};
+
+// Copies data into a raylib mesh and uploads it, must be called on the thread owning the GL context.
+// COMPACT needs vertex array objects and falls back to FLOAT on GL versions without them.
+Mesh upload_mesh(const MeshData& data, VertexFormat format = VertexFormat::FLOAT);
+// Vertex attribute streams, combined as a mask for partial updates
+constexpr uint32_t MESH_STREAM_POSITIONS = 1 << 0;
+constexpr uint32_t MESH_STREAM_NORMALS = 1 << 1;
+constexpr uint32_t MESH_STREAM_COLORS = 1 << 2;
+constexpr uint32_t MESH_STREAM_ALL = MESH_STREAM_POSITIONS | MESH_STREAM_NORMALS | MESH_STREAM_COLORS;
+
+// Overwrites the given streams of an uploaded mesh with UpdateMeshBuffer, along with its CPU-side copies.
+// data must have the mesh's vertex count in those streams, format must be the one it was uploaded with.
+void update_mesh_streams(const Mesh& mesh, const MeshData& data, uint32_t streams, VertexFormat format);
+// Bytes a mesh built from data takes up in vertex and index buffers
+size_t gpu_bytes(const MeshData& data, VertexFormat format);
+
+// Totals over every upload_mesh call since startup, for the debug overlay. Main thread only, like uploading.
+struct MeshUploadStats {
+    int meshes = 0;
+    size_t bytes = 0; // gpu_bytes in the format actually uploaded, meshes unloaded since included
+    size_t triangles = 0;
+    size_t measured_triangles = 0; // of the meshes that came with a cache_miss_ratio
+    size_t cache_misses = 0; // vertices transformed drawing those once with a VERTEX_CACHE_SIZE FIFO
+};
+const MeshUploadStats& get_upload_stats();
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logging.hpp"
+#include "render/mesh_disk_cache.hpp"
+#include "util.hpp"
+
+constexpr char MESH_FILE_MAGIC[4] = {'P','G','M','C'};
+constexpr uint32_t MESH_FILE_VERSION = 2;
+const std::string MESH_FILE_EXTENSION = ".mesh";
+
+struct MeshFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+    uint32_t recipe_size; // bytes of recipe after the header, padded to recipe_padded
+    uint32_t reserved;
+    uint64_t checksum; // FNV-1a over the arrays following the recipe
+};
+static_assert(sizeof(MeshFileHeader) == 40);
+
+// The recipe is padded to 8 bytes so the arrays after it stay aligned
+static uint32_t recipe_padded(uint32_t recipe_size) {
+    return (recipe_size + 7) & ~7u;
+}
+
+struct CacheEntry {
+    uintmax_t size;
+    uint64_t last_used;
+};
+
+static bool enabled = false;
+static std::filesystem::path cache_directory;
+static uintmax_t cache_max_bytes = 0;
+static uintmax_t cache_bytes = 0;
+static uint64_t use_clock = 0;
+static std::map<uint64_t, CacheEntry> entries;
+static int hits = 0;
+static int misses = 0;
+// Guards the bookkeeping above, files are read and written outside it so workers can load in parallel
+static std::mutex cache_mutex;
+
+static std::filesystem::path entry_path(uint64_t key) {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return cache_directory / (name + MESH_FILE_EXTENSION);
+}
+
+static uintmax_t file_size(const MeshFileHeader& header) {
+    return sizeof(MeshFileHeader) + recipe_padded(header.recipe_size) + header.vertex_count*(3*sizeof(float)*2 + 4) + header.triangle_count*3*sizeof(unsigned short);
+}
+
+// FNV-1a style mixing over 8 byte words, byte-wise FNV is slower than regenerating a petal
+static uint64_t hash_words(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word)*1099511628211ull;
+        hash ^= hash >> 32;
+    }
+    return hash_fnv1a(bytes + i, size - i, hash);
+}
+
+static uint64_t checksum(const MeshData& data) {
+    uint64_t hash = hash_words(data.vertices.data(), data.vertices.size()*sizeof(float), FNV_OFFSET_BASIS);
+    hash = hash_words(data.normals.data(), data.normals.size()*sizeof(float), hash);
+    hash = hash_words(data.colors.data(), data.colors.size(), hash);
+    return hash_words(data.indices.data(), data.indices.size()*sizeof(unsigned short), hash);
+}
+
+static void remove_entry(uint64_t key) {
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return;
+    cache_bytes -= it->second.size;
+    entries.erase(it);
+    std::error_code error;
+    std::filesystem::remove(entry_path(key), error);
+}
+
+static void evict() {
+    while (cache_bytes > cache_max_bytes && !entries.empty()) {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            if (it->second.last_used < oldest->second.last_used)
+                oldest = it;
+        }
+        remove_entry(oldest->first);
+    }
+}
+
+void MeshDiskCache::open(const std::filesystem::path& directory, uintmax_t max_bytes) {
+    close();
+    std::lock_guard lock(cache_mutex);
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        WARN("Mesh cache disabled, could not create " + directory.string());
+        return;
+    }
+    cache_directory = directory;
+    cache_max_bytes = max_bytes;
+
+    // Rebuild the LRU order from modification times, which load() refreshes on every hit
+    std::vector<std::pair<std::filesystem::file_time_type, uint64_t>> by_time;
+    for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+        if (!file.is_regular_file(error))
+            continue;
+        if (file.path().extension() == ".tmp") {
+            std::filesystem::remove(file.path(), error); // left behind by an interrupted store
+            continue;
+        }
+        if (file.path().extension() != MESH_FILE_EXTENSION)
+            continue;
+        uint64_t key = std::strtoull(file.path().stem().string().c_str(), nullptr, 16);
+        entries[key] = CacheEntry{file.file_size(error), 0};
+        cache_bytes += entries[key].size;
+        by_time.emplace_back(file.last_write_time(error), key);
+    }
+    std::sort(by_time.begin(), by_time.end());
+    for (const auto& [time, key] : by_time)
+        entries[key].last_used = ++use_clock;
+    enabled = true;
+    evict();
+    DEBUG("Opened mesh cache with " + std::to_string(entries.size()) + " entries (" + std::to_string(cache_bytes) + " bytes)");
+}
+
+void MeshDiskCache::close() {
+    std::lock_guard lock(cache_mutex);
+    enabled = false;
+    entries.clear();
+    cache_bytes = 0;
+}
+
+uint64_t MeshDiskCache::key(uint64_t content_hash) {
+    return hash_fnv1a(&MESH_FILE_VERSION, sizeof(MESH_FILE_VERSION), content_hash);
+}
+
+bool MeshDiskCache::load(uint64_t key, std::string_view recipe, MeshData& data) {
+    std::unique_lock lock(cache_mutex);
+    auto entry = entries.find(key);
+    if (!enabled || entry == entries.end()) {
+        misses++;
+        return false;
+    }
+    const uintmax_t expected_size = entry->second.size;
+    std::filesystem::path path = entry_path(key);
+    lock.unlock();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        // Evicted since the lock was released, the caller builds the mesh and stores it again
+        std::lock_guard relock(cache_mutex);
+        misses++;
+        return false;
+    }
+    MeshFileHeader header;
+    bool valid = file.read((char*)&header, sizeof(header))
+        && std::memcmp(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC)) == 0
+        && header.version == MESH_FILE_VERSION
+        && header.key == key
+        && expected_size == file_size(header);
+    std::string stored_recipe;
+    if (valid) {
+        stored_recipe.resize(recipe_padded(header.recipe_size));
+        valid = (bool)file.read(stored_recipe.data(), stored_recipe.size());
+        stored_recipe.resize(header.recipe_size);
+    }
+    // Another recipe with the same hash, a miss rather than corruption. The caller's store replaces it.
+    if (valid && stored_recipe != recipe) {
+        file.close();
+        DEBUG("Mesh cache hash collision on " + path.string());
+        std::lock_guard relock(cache_mutex);
+        misses++;
+        return false;
+    }
+    if (valid) {
+        data.resize(header.vertex_count, header.triangle_count);
+        file.read((char*)data.vertices.data(), data.vertices.size()*sizeof(float));
+        file.read((char*)data.normals.data(), data.normals.size()*sizeof(float));
+        file.read((char*)data.colors.data(), data.colors.size());
+        file.read((char*)data.indices.data(), data.indices.size()*sizeof(unsigned short));
+        valid = file && checksum(data) == header.checksum;
+    }
+    file.close();
+    lock.lock();
+    entry = entries.find(key);
+    if (!valid) {
+        // Only an entry still on record as the file that was opened is corrupt, one evicted or replaced by
+        // another store while being read just missed
+        if (entry != entries.end() && entry->second.size == expected_size) {
+            WARN("Discarding corrupt mesh cache entry " + path.string());
+            remove_entry(key);
+        }
+        misses++;
+        return false;
+    }
+    if (entry != entries.end())
+        entry->second.last_used = ++use_clock;
+    hits++;
+    lock.unlock();
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return true;
+}
+
+void MeshDiskCache::store(uint64_t key, std::string_view recipe, const MeshData& data) {
+    std::unique_lock lock(cache_mutex);
+    if (!enabled)
+        return;
+    std::filesystem::path path = entry_path(key);
+    lock.unlock();
+    MeshFileHeader header;
+    std::memcpy(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC));
+    header.version = MESH_FILE_VERSION;
+    header.key = key;
+    header.vertex_count = data.vertex_count();
+    header.triangle_count = data.triangle_count();
+    header.recipe_size = recipe.size();
+    header.reserved = 0;
+    header.checksum = checksum(data);
+    std::string padded_recipe(recipe);
+    padded_recipe.resize(recipe_padded(header.recipe_size), '\0');
+
+    // Written beside the final name and renamed into place, so readers never see a partial file. Workers
+    // storing the same mesh each write their own temporary.
+    std::filesystem::path temporary = path;
+    temporary += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    file.write(padded_recipe.data(), padded_recipe.size());
+    file.write((const char*)data.vertices.data(), data.vertices.size()*sizeof(float));
+    file.write((const char*)data.normals.data(), data.normals.size()*sizeof(float));
+    file.write((const char*)data.colors.data(), data.colors.size());
+    file.write((const char*)data.indices.data(), data.indices.size()*sizeof(unsigned short));
+    file.close();
+    std::error_code error;
+    if (!file) {
+        std::filesystem::remove(temporary, error);
+        WARN("Could not write mesh cache entry " + path.string());
+        return;
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+
+    lock.lock();
+    if (entries.find(key) != entries.end())
+        cache_bytes -= entries[key].size;
+    entries[key] = CacheEntry{file_size(header), ++use_clock};
+    cache_bytes += entries[key].size;
+    evict();
+}
+
+int MeshDiskCache::get_hits() {
+    std::lock_guard lock(cache_mutex);
+    return hits;
+}
+
+int MeshDiskCache::get_misses() {
+    std::lock_guard lock(cache_mutex);
+    return misses;
+}
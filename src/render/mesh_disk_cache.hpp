@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#include "render/mesh_data.hpp"
+
+// Content addressed store of generated meshes on disk, so loading a garden does not regenerate geometry it
+// has built before. Each entry is one file named by the content hash of its generation inputs holding a fixed
+// header, the generation inputs themselves (the recipe) and the raw MeshData arrays, laid out so the file
+// could be mapped and used in place. A load only succeeds if the stored recipe matches the caller's exactly,
+// two recipes sharing a hash just replace each other's entry. Least recently used entries are evicted once
+// the directory grows past its byte budget.
+class MeshDiskCache {
+public:
+    static void open(const std::filesystem::path& directory, uintmax_t max_bytes);
+    static void close();
+
+    static uint64_t key(uint64_t content_hash);
+    static bool load(uint64_t key, std::string_view recipe, MeshData& data);
+    static void store(uint64_t key, std::string_view recipe, const MeshData& data);
+
+    static int get_hits();
+    static int get_misses();
+};
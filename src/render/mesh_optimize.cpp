@@ -0,0 +1,102 @@
+#include <vector>
+
+#include "render/mesh_optimize.hpp"
+
+void optimize_vertex_cache(MeshData& data) {
+    const int vertex_count = data.vertex_count();
+    const int triangle_count = data.triangle_count();
+    if (triangle_count == 0)
+        return;
+
+    // Triangles using each vertex as ranges of one flat list
+    std::vector<int> offsets(vertex_count+1, 0);
+    for (unsigned short index : data.indices)
+        offsets[index+1]++;
+    for (int v = 0; v < vertex_count; v++)
+        offsets[v+1] += offsets[v];
+    std::vector<int> live(vertex_count, 0); // triangles not emitted yet
+    std::vector<int> adjacency(data.indices.size());
+    for (int t = 0; t < triangle_count; t++) {
+        for (int k = 0; k < 3; k++) {
+            int v = data.indices[t*3+k];
+            adjacency[offsets[v] + live[v]++] = t;
+        }
+    }
+
+    // Vertex v is in the simulated FIFO cache while time - cached[v] < VERTEX_CACHE_SIZE
+    std::vector<int> cached(vertex_count, -VERTEX_CACHE_SIZE);
+    int time = 0;
+    std::vector<char> emitted(triangle_count, false);
+    std::vector<int> dead_ends;
+    dead_ends.reserve(data.indices.size());
+    std::vector<int> candidates;
+    std::vector<unsigned short> order;
+    order.reserve(data.indices.size());
+    int cursor = 0;
+    int fan = data.indices[0];
+    while (fan >= 0) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (int i = offsets[fan]; i < offsets[fan+1]; i++) {
+            int t = adjacency[i];
+            if (emitted[t])
+                continue;
+            emitted[t] = true;
+            for (int k = 0; k < 3; k++) {
+                int v = data.indices[t*3+k];
+                order.push_back(v);
+                dead_ends.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cached[v] >= VERTEX_CACHE_SIZE)
+                    cached[v] = time++;
+            }
+        }
+
+        // Continue with the neighbour that stays in the cache after its own fan and entered it earliest
+        fan = -1;
+        int best_priority = -1;
+        for (int v : candidates) {
+            if (live[v] == 0)
+                continue;
+            int priority = 0;
+            if (time - cached[v] + 2*live[v] <= VERTEX_CACHE_SIZE)
+                priority = time - cached[v];
+            if (priority > best_priority) {
+                best_priority = priority;
+                fan = v;
+            }
+        }
+        if (fan >= 0)
+            continue;
+
+        // Dead end, back up to a recently used vertex with triangles left, then to the next one in order
+        while (!dead_ends.empty() && fan < 0) {
+            int v = dead_ends.back();
+            dead_ends.pop_back();
+            if (live[v] > 0)
+                fan = v;
+        }
+        while (fan < 0 && cursor < vertex_count) {
+            if (live[cursor] > 0)
+                fan = cursor;
+            cursor++;
+        }
+    }
+    data.indices = std::move(order);
+}
+
+float average_cache_miss_ratio(const MeshData& data, int cache_size) {
+    if (data.triangle_count() == 0)
+        return 0.0f;
+    // A vertex is still cached if fewer than cache_size misses happened since it was loaded
+    std::vector<int> loaded(data.vertex_count(), -cache_size);
+    int misses = 0;
+    for (unsigned short index : data.indices) {
+        if (misses - loaded[index] >= cache_size) {
+            loaded[index] = misses;
+            misses++;
+        }
+    }
+    return misses/(float)data.triangle_count();
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "render/mesh_data.hpp"
+
+// Size of the post-transform vertex cache the optimizer targets and ACMR is measured against
+constexpr int VERTEX_CACHE_SIZE = 16;
+
+// Reorders triangles so consecutive ones reuse recently transformed vertices (Tipsify, Sander et al. 2007).
+// Only the triangle order changes, the vertex arrays, windings and the set of triangles stay the same.
+void optimize_vertex_cache(MeshData& data);
+// Average cache miss ratio, vertices transformed per triangle with a FIFO cache, 0.5 is the best a
+// regular grid can reach and 3 means no reuse at all
+float average_cache_miss_ratio(const MeshData& data, int cache_size = VERTEX_CACHE_SIZE);
@@ -0,0 +1,93 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <deque>
+
+#include "object/object3d.hpp"
+#include "render/mesh_queue.hpp"
+#include "util.hpp"
+#include "worker_pool.hpp"
+
+struct MeshJob {
+    std::function<void()> build;
+    std::function<bool()> upload;
+    std::atomic<bool> prepared = false;
+};
+
+static std::deque<std::shared_ptr<MeshJob>> jobs;
+static MeshQueueStats stats;
+
+// Removed and reset objects lose their id, their staged data goes with them
+static bool upload_object(ParameterObject& object) {
+    if (object.get_id() == 0)
+        return false;
+    object.generate_mesh();
+    return true;
+}
+
+void MeshQueue::enqueue(std::shared_ptr<ParameterObject> object) {
+    std::function<void()> build = object->mesh_job();
+    if (!build)
+        build = []() {};
+    enqueue(std::move(build), [object]() {return upload_object(*object);});
+}
+
+void MeshQueue::enqueue_prepared(std::shared_ptr<ParameterObject> object) {
+    assert(is_main_thread());
+    auto job = std::make_shared<MeshJob>();
+    job->upload = [object]() {return upload_object(*object);};
+    job->prepared = true;
+    jobs.push_back(job);
+    stats.queued = jobs.size();
+}
+
+void MeshQueue::enqueue(std::function<void()> build, std::function<bool()> upload) {
+    assert(is_main_thread());
+    auto job = std::make_shared<MeshJob>();
+    job->build = std::move(build);
+    job->upload = std::move(upload);
+    jobs.push_back(job);
+    stats.queued = jobs.size();
+    WorkerPool::submit([job]() {
+        try {
+            job->build();
+        } catch (...) {} // nothing staged, upload has to build it on the main thread instead
+        job->prepared = true;
+    });
+}
+
+void MeshQueue::update(float budget_ms) {
+    assert(is_main_thread());
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    float elapsed_ms = 0.0f;
+    stats.uploaded = 0;
+    for (auto it = jobs.begin(); it != jobs.end();) {
+        MeshJob& job = **it;
+        if (!job.prepared) {
+            it++;
+            continue;
+        }
+        if (stats.uploaded > 0 && elapsed_ms >= budget_ms)
+            break;
+        if (job.upload()) {
+            stats.uploaded++;
+            elapsed_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+        }
+        it = jobs.erase(it);
+    }
+    stats.upload_ms = elapsed_ms;
+    stats.queued = jobs.size();
+}
+
+// Jobs still on a worker keep their object alive until they finish
+void MeshQueue::clear() {
+    assert(is_main_thread());
+    jobs.clear();
+    stats = MeshQueueStats{};
+}
+
+const MeshQueueStats& MeshQueue::get_stats() {
+    assert(is_main_thread());
+    return stats;
+}
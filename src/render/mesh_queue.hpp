@@ -0,0 +1,31 @@
+#pragma once
+#include <functional>
+#include <memory>
+
+class ParameterObject;
+
+struct MeshQueueStats {
+    int queued = 0; // objects still waiting for a mesh, building or ready to upload
+    int uploaded = 0; // meshes uploaded by the last update
+    float upload_ms = 0.0f; // main thread time the last update spent uploading
+};
+
+// Builds meshes of procedural objects that arrive at runtime on the worker pool and uploads as many as fit a
+// per-frame time budget, so a burst of loads never stalls a frame. Queued objects draw nothing until theirs
+// is uploaded. Workers only see the copy mesh_job took, an object edited while queued rebuilds on upload.
+// Main thread only, workers report back through the jobs' own flags.
+class MeshQueue {
+public:
+    static void enqueue(std::shared_ptr<ParameterObject> object);
+    // For objects whose prepare_mesh has already run, only the upload is left to queue
+    static void enqueue_prepared(std::shared_ptr<ParameterObject> object);
+    // build runs on a worker and may only touch what it captured, upload follows on the main thread once it
+    // is done and returns whether it uploaded anything
+    static void enqueue(std::function<void()> build, std::function<bool()> upload);
+    // Main thread, once a frame. Uploads finished meshes in arrival order until the budget is spent, always at
+    // least one so a mesh larger than the budget still gets through. Objects removed from the world are dropped.
+    static void update(float budget_ms);
+    static void clear();
+
+    static const MeshQueueStats& get_stats();
+};
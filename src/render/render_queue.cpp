@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#include "render/render_queue.hpp"
+
+#include "rlgl.h"
+#include "raymath.h"
+
+constexpr int RADIX_BITS = 8;
+constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+constexpr int RADIX_PASSES = 64/RADIX_BITS;
+
+// Ids past what a field holds share its last value, that only costs sort quality since binds compare the
+// actual pointers
+static uint64_t key_field(uint32_t id, int bits) {
+    return std::min<uint32_t>(id, (1u << bits) - 1);
+}
+
+void RenderQueue::begin(Vector3 view_position) {
+    view_position_ = view_position;
+    draws_.clear();
+    entries_.clear();
+    shader_ids_.clear();
+    material_ids_.clear();
+    mesh_ids_.clear();
+    stats_ = RenderQueueStats{};
+}
+
+void RenderQueue::add(const Mesh& mesh, const Material& material, const Matrix& transform, bool cull_back_faces) {
+    const Vector3 offset = {transform.m12 - view_position_.x, transform.m13 - view_position_.y, transform.m14 - view_position_.z};
+    entries_.push_back({make_key(mesh, material, cull_back_faces, Vector3DotProduct(offset, offset)), (uint32_t)draws_.size()});
+    draws_.push_back({&mesh, &material, transform, nullptr, 1, cull_back_faces});
+}
+
+void RenderQueue::add_instanced(const Mesh& mesh, const Material& material, const Matrix* transforms, int count, bool cull_back_faces) {
+    if (count <= 0)
+        return;
+    entries_.push_back({make_key(mesh, material, cull_back_faces, 0.0f), (uint32_t)draws_.size()});
+    draws_.push_back({&mesh, &material, MatrixIdentity(), transforms, count, cull_back_faces});
+}
+
+// Front to back within a run, squared distances order like distances and positive floats order like
+// their bit patterns, so the top bits of the pattern are the depth
+uint64_t RenderQueue::make_key(const Mesh& mesh, const Material& material, bool cull_back_faces, float depth) {
+    auto shader = std::find(shader_ids_.begin(), shader_ids_.end(), material.shader.id);
+    if (shader == shader_ids_.end())
+        shader = shader_ids_.insert(shader, material.shader.id);
+    const uint32_t shader_id = shader - shader_ids_.begin();
+    const uint32_t material_id = material_ids_.try_emplace(&material, material_ids_.size()).first->second;
+    const uint32_t mesh_id = mesh_ids_.try_emplace(&mesh, mesh_ids_.size()).first->second;
+    const uint64_t depth_bits = std::bit_cast<uint32_t>(depth) >> (32 - 1 - RENDER_KEY_DEPTH_BITS);
+
+    uint64_t key = key_field(shader_id, RENDER_KEY_SHADER_BITS);
+    key = key << RENDER_KEY_MATERIAL_BITS | key_field(material_id, RENDER_KEY_MATERIAL_BITS);
+    key = key << RENDER_KEY_CULL_BITS | (cull_back_faces ? 0 : 1);
+    key = key << RENDER_KEY_MESH_BITS | key_field(mesh_id, RENDER_KEY_MESH_BITS);
+    key = key << RENDER_KEY_DEPTH_BITS | depth_bits;
+    return key;
+}
+
+// LSD radix sort on the keys, byte columns every entry agrees on are skipped without a pass
+void RenderQueue::sort() {
+    const size_t count = entries_.size();
+    std::array<std::array<uint32_t, RADIX_BUCKETS>, RADIX_PASSES> histograms = {};
+    for (const Entry& entry : entries_) {
+        for (int pass = 0; pass < RADIX_PASSES; pass++)
+            histograms[pass][(entry.key >> (pass*RADIX_BITS)) & (RADIX_BUCKETS-1)]++;
+    }
+    scratch_.resize(count);
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        std::array<uint32_t, RADIX_BUCKETS>& histogram = histograms[pass];
+        const int shift = pass*RADIX_BITS;
+        if (histogram[(entries_[0].key >> shift) & (RADIX_BUCKETS-1)] == count)
+            continue;
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (const Entry& entry : entries_)
+            scratch_[histogram[(entry.key >> shift) & (RADIX_BUCKETS-1)]++] = entry;
+        entries_.swap(scratch_);
+    }
+}
+
+// Uniforms and textures DrawMesh would set for the material, done once per run instead of per draw
+static void bind_material(const Material& material) {
+    const int* locs = material.shader.locs;
+    if (locs[SHADER_LOC_COLOR_DIFFUSE] != -1) {
+        const Color color = material.maps[MATERIAL_MAP_DIFFUSE].color;
+        float values[4] = {color.r/255.0f, color.g/255.0f, color.b/255.0f, color.a/255.0f};
+        rlSetUniform(locs[SHADER_LOC_COLOR_DIFFUSE], values, SHADER_UNIFORM_VEC4, 1);
+    }
+    if (locs[SHADER_LOC_COLOR_SPECULAR] != -1) {
+        const Color color = material.maps[MATERIAL_MAP_SPECULAR].color;
+        float values[4] = {color.r/255.0f, color.g/255.0f, color.b/255.0f, color.a/255.0f};
+        rlSetUniform(locs[SHADER_LOC_COLOR_SPECULAR], values, SHADER_UNIFORM_VEC4, 1);
+    }
+    // Cubemap slots are left out, no material here uses them
+    for (int i = 0; i < MATERIAL_MAP_CUBEMAP; i++) {
+        if (material.maps[i].texture.id == 0)
+            continue;
+        rlActiveTextureSlot(i);
+        rlEnableTexture(material.maps[i].texture.id);
+        rlSetUniform(locs[SHADER_LOC_MAP_DIFFUSE + i], &i, SHADER_UNIFORM_INT, 1);
+    }
+}
+
+static void unbind_textures() {
+    for (int i = 0; i < MATERIAL_MAP_CUBEMAP; i++) {
+        rlActiveTextureSlot(i);
+        rlDisableTexture();
+    }
+    rlActiveTextureSlot(0);
+}
+
+// Same uniforms as DrawMesh, the rlgl transform stack is assumed to be identity as it is in BeginMode3D
+void RenderQueue::flush() {
+    if (entries_.empty())
+        return;
+    sort();
+
+    const Matrix view = rlGetMatrixModelview();
+    const Matrix projection = rlGetMatrixProjection();
+    const Matrix view_projection = MatrixMultiply(view, projection);
+    unsigned int bound_shader = 0;
+    const Material* bound_material = nullptr;
+    const Mesh* bound_mesh = nullptr;
+    bool culling = true;
+    for (const Entry& entry : entries_) {
+        const Draw& draw = draws_[entry.draw];
+        stats_.draws++;
+        if (draw.cull_back_faces != culling) {
+            culling = draw.cull_back_faces;
+            if (culling) rlEnableBackfaceCulling();
+            else rlDisableBackfaceCulling();
+            stats_.cull_changes++;
+        }
+
+        // DrawMeshInstanced binds and unbinds everything itself
+        if (draw.instances != nullptr) {
+            if (bound_shader != 0)
+                unbind_textures();
+            DrawMeshInstanced(*draw.mesh, *draw.material, draw.instances, draw.instance_count);
+            stats_.shader_binds++;
+            stats_.material_binds++;
+            stats_.mesh_binds++;
+            bound_shader = 0;
+            bound_material = nullptr;
+            bound_mesh = nullptr;
+            continue;
+        }
+
+        const Shader& shader = draw.material->shader;
+        if (shader.id != bound_shader) {
+            rlEnableShader(shader.id);
+            if (shader.locs[SHADER_LOC_MATRIX_VIEW] != -1) rlSetUniformMatrix(shader.locs[SHADER_LOC_MATRIX_VIEW], view);
+            if (shader.locs[SHADER_LOC_MATRIX_PROJECTION] != -1) rlSetUniformMatrix(shader.locs[SHADER_LOC_MATRIX_PROJECTION], projection);
+            bound_shader = shader.id;
+            bound_material = nullptr; // material uniforms belong to the program
+            stats_.shader_binds++;
+        }
+        if (draw.material != bound_material) {
+            bind_material(*draw.material);
+            bound_material = draw.material;
+            stats_.material_binds++;
+        }
+        if (draw.mesh != bound_mesh) {
+            if (!rlEnableVertexArray(draw.mesh->vaoId)) {
+                // Meshes without a vertex array go through DrawMesh, which leaves nothing bound
+                unbind_textures();
+                DrawMesh(*draw.mesh, *draw.material, draw.transform);
+                stats_.shader_binds++;
+                stats_.material_binds++;
+                stats_.mesh_binds++;
+                bound_shader = 0;
+                bound_material = nullptr;
+                bound_mesh = nullptr;
+                continue;
+            }
+            bound_mesh = draw.mesh;
+            stats_.mesh_binds++;
+        }
+
+        if (shader.locs[SHADER_LOC_MATRIX_MODEL] != -1) rlSetUniformMatrix(shader.locs[SHADER_LOC_MATRIX_MODEL], draw.transform);
+        if (shader.locs[SHADER_LOC_MATRIX_NORMAL] != -1) rlSetUniformMatrix(shader.locs[SHADER_LOC_MATRIX_NORMAL], MatrixTranspose(MatrixInvert(draw.transform)));
+        rlSetUniformMatrix(shader.locs[SHADER_LOC_MATRIX_MVP], MatrixMultiply(draw.transform, view_projection));
+        if (draw.mesh->indices != nullptr)
+            rlDrawVertexArrayElements(0, draw.mesh->triangleCount*3, 0);
+        else
+            rlDrawVertexArray(0, draw.mesh->vertexCount);
+    }
+
+    if (bound_shader != 0) {
+        unbind_textures();
+        rlDisableVertexArray();
+        rlDisableShader();
+    }
+    if (!culling)
+        rlEnableBackfaceCulling();
+}
+
+const RenderQueueStats& RenderQueue::get_stats() const {
+    return stats_;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "raylib.h"
+
+// Sort key fields from most to least significant, draws sharing a prefix share that much GL state
+constexpr int RENDER_KEY_SHADER_BITS = 8;
+constexpr int RENDER_KEY_MATERIAL_BITS = 16;
+constexpr int RENDER_KEY_CULL_BITS = 1;
+constexpr int RENDER_KEY_MESH_BITS = 20;
+constexpr int RENDER_KEY_DEPTH_BITS = 19;
+static_assert(RENDER_KEY_SHADER_BITS + RENDER_KEY_MATERIAL_BITS + RENDER_KEY_CULL_BITS + RENDER_KEY_MESH_BITS + RENDER_KEY_DEPTH_BITS == 64);
+
+// State changes made by one flush, a draw that reuses what is bound costs none
+struct RenderQueueStats {
+    int draws = 0;
+    int shader_binds = 0;
+    int material_binds = 0;
+    int mesh_binds = 0;
+    int cull_changes = 0;
+};
+
+// Collects a frame's draws as compact keys (shader, material, culling, mesh, depth), radix sorts them and
+// submits each run of draws sharing a shader, material or mesh with a single bind
+class RenderQueue {
+public:
+    void begin(Vector3 view_position);
+    // mesh and material have to outlive the flush that draws them
+    void add(const Mesh& mesh, const Material& material, const Matrix& transform, bool cull_back_faces = true);
+    // One DrawMeshInstanced call, transforms has to stay valid until flush as well
+    void add_instanced(const Mesh& mesh, const Material& material, const Matrix* transforms, int count, bool cull_back_faces = true);
+    void flush();
+
+    const RenderQueueStats& get_stats() const;
+private:
+    struct Draw {
+        const Mesh* mesh;
+        const Material* material;
+        Matrix transform;
+        const Matrix* instances; // null for a single draw
+        int instance_count;
+        bool cull_back_faces;
+    };
+    struct Entry {
+        uint64_t key;
+        uint32_t draw;
+    };
+
+    uint64_t make_key(const Mesh& mesh, const Material& material, bool cull_back_faces, float depth);
+    void sort();
+
+    Vector3 view_position_ = {0.0f,0.0f,0.0f};
+    std::vector<Draw> draws_;
+    std::vector<Entry> entries_;
+    std::vector<Entry> scratch_;
+    // Dense per-frame ids in order of first use, only the key needs them
+    std::vector<unsigned int> shader_ids_;
+    std::unordered_map<const Material*, uint32_t> material_ids_;
+    std::unordered_map<const Mesh*, uint32_t> mesh_ids_;
+    RenderQueueStats stats_;
+};
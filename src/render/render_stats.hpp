@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+
+// Per-frame counters for the debug overlay
+struct RenderStats {
+    int submitted = 0; // objects that passed culling
+    int culled = 0;
+    int draw_calls = 0;
+    int triangles = 0;
+    int shader_binds = 0; // state changes while submitting the sorted draws
+    int material_binds = 0;
+    int mesh_binds = 0;
+    int static_batches = 0; // merged meshes that passed culling
+    int static_batched = 0; // objects drawn through them
+    int mesh_queue = 0; // procedural objects still waiting for their mesh
+    int mesh_uploads = 0;
+    float mesh_upload_ms = 0.0f;
+    size_t mesh_bytes = 0; // vertex and index buffers uploaded since startup
+    float cache_miss_ratio = 0.0f; // of the uploads measured where they were built, see average_cache_miss_ratio
+};
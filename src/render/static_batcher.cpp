@@ -0,0 +1,269 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "object/object3d.hpp"
+#include "render/asset_cache.hpp"
+#include "render/instance_batcher.hpp"
+#include "render/mesh_data.hpp"
+#include "render/static_batcher.hpp"
+#include "worker_pool.hpp"
+
+#include "raymath.h"
+
+// Everything a rebuild reads is copied out on the main thread, the worker only sees the job. The job is
+// owned by its region and never freed before built is set, so releasing the mesh handles, which can unload
+// them, always happens on the main thread.
+struct StaticBatcher::Job {
+    struct Input {
+        std::shared_ptr<const Mesh> mesh;
+        Matrix transform;
+        Color color;
+        int shader; // index into shaders
+    };
+    struct Piece {
+        int shader;
+        MeshData data;
+    };
+
+    std::vector<Input> inputs;
+    std::vector<Shader> shaders;
+    std::vector<Piece> pieces;
+    std::atomic<bool> built = false;
+
+    void build();
+};
+
+// Objects are only scaled uniformly, so the normals just need the rotation and renormalizing
+static void append_mesh(MeshData& data, const Mesh& mesh, const Matrix& transform, Color color) {
+    const int base = data.vertex_count();
+    Matrix rotation = transform;
+    rotation.m12 = rotation.m13 = rotation.m14 = 0.0f;
+    const unsigned char tint[4] = {color.r, color.g, color.b, color.a};
+    for (int v = 0; v < mesh.vertexCount; v++) {
+        Vector3 position = Vector3Transform({mesh.vertices[v*3], mesh.vertices[v*3+1], mesh.vertices[v*3+2]}, transform);
+        Vector3 normal = Vector3Normalize(Vector3Transform({mesh.normals[v*3], mesh.normals[v*3+1], mesh.normals[v*3+2]}, rotation));
+        data.vertices.insert(data.vertices.end(), {position.x, position.y, position.z});
+        data.normals.insert(data.normals.end(), {normal.x, normal.y, normal.z});
+        for (int k = 0; k < 4; k++) {
+            int channel = mesh.colors != nullptr ? mesh.colors[v*4+k] : 255;
+            data.colors.push_back((channel*tint[k] + 127)/255);
+        }
+    }
+    if (mesh.indices != nullptr) {
+        for (int i = 0; i < mesh.triangleCount*3; i++)
+            data.indices.push_back(base + mesh.indices[i]);
+    } else {
+        for (int v = 0; v < mesh.vertexCount; v++)
+            data.indices.push_back(base + v);
+    }
+}
+
+// One piece per shader, split further wherever the next mesh would overflow the index range
+void StaticBatcher::Job::build() {
+    for (int shader = 0; shader < (int)shaders.size(); shader++) {
+        int piece = -1;
+        for (const Input& input : inputs) {
+            if (input.shader != shader)
+                continue;
+            if (piece == -1 || pieces[piece].data.vertex_count() + input.mesh->vertexCount > STATIC_BATCH_MAX_VERTICES) {
+                pieces.push_back({shader, MeshData{}});
+                piece = pieces.size() - 1;
+            }
+            append_mesh(pieces[piece].data, *input.mesh, input.transform, input.color);
+        }
+    }
+}
+
+// Needs the float attributes on the CPU side, which COMPACT meshes drop
+static bool is_batchable(const Object3d& object) {
+    if (!object.is_static_batchable())
+        return false;
+    const std::shared_ptr<const Mesh>& mesh = object.get_mesh();
+    return mesh != nullptr && mesh->vertices != nullptr && mesh->normals != nullptr && mesh->vertexCount <= STATIC_BATCH_MAX_VERTICES && object.get_material() != nullptr;
+}
+
+static int64_t region_key(Vector3 position) {
+    const int32_t x = std::floor(position.x/STATIC_BATCH_REGION_SIZE);
+    const int32_t z = std::floor(position.z/STATIC_BATCH_REGION_SIZE);
+    return (int64_t)x << 32 | (uint32_t)z;
+}
+
+StaticBatcher::StaticBatcher() = default;
+
+// Jobs still on a worker hold meshes, so they are waited for rather than released under it
+StaticBatcher::~StaticBatcher() {
+    for (auto& [key, region] : regions_) {
+        if (region.job != nullptr)
+            abandon_job(std::move(region.job));
+    }
+    for (const std::unique_ptr<Job>& job : abandoned_) {
+        while (!job->built)
+            std::this_thread::yield();
+    }
+}
+
+void StaticBatcher::add(uint32_t id, Object3d* object) {
+    if (member_slots_.count(id) != 0)
+        return;
+    member_slots_[id] = members_.size();
+    members_.push_back({object, id, object->get_revision(), time_, is_batchable(*object)});
+}
+
+void StaticBatcher::remove(uint32_t id) {
+    auto it = member_slots_.find(id);
+    if (it == member_slots_.end())
+        return;
+    const size_t slot = it->second;
+    if (members_[slot].in_region)
+        leave_region(members_[slot]);
+    member_slots_.erase(it);
+    if (slot != members_.size() - 1) {
+        members_[slot] = members_.back();
+        member_slots_[members_[slot].id] = slot;
+    }
+    members_.pop_back();
+}
+
+void StaticBatcher::clear() {
+    for (auto& [key, region] : regions_) {
+        if (region.job != nullptr)
+            abandon_job(std::move(region.job));
+    }
+    regions_.clear();
+    members_.clear();
+    member_slots_.clear();
+    stats_ = StaticBatchStats{};
+}
+
+void StaticBatcher::update(double time, float budget_ms) {
+    using Clock = std::chrono::steady_clock;
+    time_ = time;
+    for (Member& member : members_) {
+        const uint32_t revision = member.object->get_revision();
+        if (revision != member.revision) {
+            member.revision = revision;
+            member.changed_at = time;
+            member.batchable = is_batchable(*member.object);
+            if (member.in_region)
+                leave_region(member);
+        } else if (!member.in_region && member.batchable && time - member.changed_at >= STATIC_BATCH_QUIET_SECONDS) {
+            join_region(member);
+        }
+    }
+    std::erase_if(abandoned_, [](const std::unique_ptr<Job>& job) {return job->built.load();});
+
+    const Clock::time_point start = Clock::now();
+    stats_ = StaticBatchStats{};
+    for (auto it = regions_.begin(); it != regions_.end();) {
+        Region& region = it->second;
+        if (region.job != nullptr && region.job->built) {
+            if (stats_.uploaded == 0 || std::chrono::duration<float, std::milli>(Clock::now() - start).count() < budget_ms)
+                finish_job(region);
+        }
+        if (region.job == nullptr && region.dirty) {
+            if (region.ids.empty()) {
+                it = regions_.erase(it);
+                continue;
+            }
+            start_job(region);
+        }
+        stats_.batches += region.batches.size();
+        stats_.building += region.job != nullptr;
+        it++;
+    }
+    stats_.regions = regions_.size();
+    for (const Member& member : members_)
+        stats_.batched += member.batched;
+}
+
+bool StaticBatcher::is_batched(uint32_t id) const {
+    auto it = member_slots_.find(id);
+    return it != member_slots_.end() && members_[it->second].batched;
+}
+
+void StaticBatcher::submit(InstanceBatcher& batcher, const Frustum& frustum) const {
+    for (const auto& [key, region] : regions_) {
+        for (const Batch& batch : region.batches) {
+            if (frustum.test(batch.bounds) != FrustumTest::OUTSIDE)
+                batcher.add_draw(*batch.mesh, *batch.material, MatrixIdentity());
+        }
+    }
+}
+
+const StaticBatchStats& StaticBatcher::get_stats() const {
+    return stats_;
+}
+
+void StaticBatcher::join_region(Member& member) {
+    member.region = region_key(member.object->get_position());
+    member.in_region = true;
+    Region& region = regions_[member.region];
+    region.ids.push_back(member.id);
+    region.dirty = true;
+}
+
+// The batches still contain the member, so the whole region goes back to drawing one by one until rebuilt
+void StaticBatcher::leave_region(Member& member) {
+    Region& region = regions_.at(member.region);
+    std::erase(region.ids, member.id);
+    region.dirty = true;
+    if (!region.batches.empty()) {
+        for (uint32_t id : region.ids)
+            members_[member_slots_.at(id)].batched = false;
+        region.batches.clear();
+    }
+    member.in_region = false;
+    member.batched = false;
+}
+
+void StaticBatcher::start_job(Region& region) {
+    auto job = std::make_unique<Job>();
+    job->inputs.reserve(region.ids.size());
+    for (uint32_t id : region.ids) {
+        const Object3d& object = *members_[member_slots_.at(id)].object;
+        const Material& material = *object.get_material();
+        int shader = 0;
+        while (shader < (int)job->shaders.size() && job->shaders[shader].id != material.shader.id)
+            shader++;
+        if (shader == (int)job->shaders.size())
+            job->shaders.push_back(material.shader);
+        job->inputs.push_back({object.get_mesh(), object.get_matrix(), material.maps[MATERIAL_MAP_DIFFUSE].color, shader});
+    }
+    region.dirty = false;
+    Job* running = job.get();
+    region.job = std::move(job);
+    WorkerPool::submit([running]() {
+        try {
+            running->build();
+        } catch (...) {
+            running->pieces.clear(); // the region stays unbatched until it changes again
+        }
+        running->built = true;
+    });
+}
+
+// A region that changed while its job ran starts over with a fresh one, its old batches are still valid
+// for the members they contain
+void StaticBatcher::finish_job(Region& region) {
+    std::unique_ptr<Job> job = std::move(region.job);
+    if (region.dirty || job->pieces.empty())
+        return;
+    region.batches.clear();
+    for (const Job::Piece& piece : job->pieces) {
+        region.batches.push_back({
+            make_shared_mesh(upload_mesh(piece.data)),
+            AssetCache::material(WHITE, job->shaders[piece.shader]),
+            piece.data.get_bounding_box()
+        });
+    }
+    for (uint32_t id : region.ids)
+        members_[member_slots_.at(id)].batched = true;
+    stats_.uploaded += job->pieces.size();
+}
+
+void StaticBatcher::abandon_job(std::unique_ptr<Job> job) {
+    if (!job->built)
+        abandoned_.push_back(std::move(job));
+}
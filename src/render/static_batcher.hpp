@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "raylib.h"
+
+#include "render/frustum.hpp"
+
+class Object3d;
+class InstanceBatcher;
+
+constexpr double STATIC_BATCH_QUIET_SECONDS = 5.0; // untouched this long before an object is merged
+constexpr float STATIC_BATCH_REGION_SIZE = 32.0f; // edge of the square cells on the ground objects are grouped by
+constexpr int STATIC_BATCH_MAX_VERTICES = 65536; // indices are unsigned short
+
+struct StaticBatchStats {
+    int regions = 0;
+    int batches = 0; // merged meshes across all regions, each one draw
+    int batched = 0; // objects drawn through a batch instead of on their own
+    int building = 0; // regions with a rebuild running on the worker pool
+    int uploaded = 0; // batches uploaded by the last update
+};
+
+// Merges objects that have not changed for a while into pre-transformed meshes per region, one per shader
+// with the material colors baked into the vertex colors. A region rebuilds on the worker pool when objects
+// join it and drops its batches as soon as one of them changes, drawing them one by one until the rebuild
+// is uploaded. Only the regions that changed are rebuilt.
+class StaticBatcher {
+public:
+    StaticBatcher();
+    ~StaticBatcher();
+    StaticBatcher(const StaticBatcher&) = delete;
+    StaticBatcher& operator=(const StaticBatcher&) = delete;
+
+    // object has to stay valid until it is removed
+    void add(uint32_t id, Object3d* object);
+    void remove(uint32_t id);
+    void clear();
+
+    // Main thread, once a frame after the transforms are rebuilt. Notices changed objects through their
+    // revision, starts rebuilds and uploads finished ones until budget_ms is spent, at least one.
+    void update(double time, float budget_ms);
+    bool is_batched(uint32_t id) const;
+    void submit(InstanceBatcher& batcher, const Frustum& frustum) const;
+
+    const StaticBatchStats& get_stats() const;
+private:
+    struct Member {
+        Object3d* object;
+        uint32_t id;
+        uint32_t revision;
+        double changed_at;
+        bool batchable;
+        bool in_region = false;
+        bool batched = false;
+        int64_t region = 0;
+    };
+    struct Batch {
+        std::shared_ptr<const Mesh> mesh;
+        std::shared_ptr<Material> material;
+        BoundingBox bounds;
+    };
+    struct Job;
+    struct Region {
+        std::vector<uint32_t> ids;
+        std::vector<Batch> batches;
+        std::unique_ptr<Job> job;
+        bool dirty = false; // membership changed since the running job, or the batches, were started
+    };
+
+    void join_region(Member& member);
+    void leave_region(Member& member);
+    void start_job(Region& region);
+    void finish_job(Region& region);
+    void abandon_job(std::unique_ptr<Job> job);
+
+    std::vector<Member> members_;
+    std::unordered_map<uint32_t, size_t> member_slots_; // id -> index into members_
+    std::unordered_map<int64_t, Region> regions_;
+    std::vector<std::unique_ptr<Job>> abandoned_; // still running on a worker after their region went away
+    double time_ = 0.0;
+    StaticBatchStats stats_;
+};
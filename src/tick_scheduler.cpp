@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cmath>
+
+#include "tick_scheduler.hpp"
+
+TickScheduler::TickScheduler(float tick_rate) : tick_rate_(tick_rate) {
+    durations_.reserve(TICK_TIMING_WINDOW);
+}
+
+void TickScheduler::set_tick_rate(float tick_rate) {
+    if (tick_rate <= 0.0f)
+        return;
+    // Carry the fraction of a tick over, not the seconds, so a tick that was half due stays half due
+    accumulator_ *= tick_rate_/tick_rate;
+    tick_rate_ = tick_rate;
+    for (Task& task : tasks_) {
+        task.period = period_of(task.interval);
+        task.next_tick = std::min(task.next_tick, tick_ + task.period);
+    }
+}
+
+float TickScheduler::get_tick_rate() const {
+    return tick_rate_;
+}
+
+int TickScheduler::add_task(float interval, std::function<void()> task, bool run_at_start) {
+    const uint64_t period = period_of(interval);
+    tasks_.push_back({interval, period, run_at_start ? tick_ : tick_ + period, run_at_start, std::move(task)});
+    return tasks_.size() - 1;
+}
+
+void TickScheduler::set_task_interval(int task, float interval) {
+    tasks_[task].interval = interval;
+    tasks_[task].period = period_of(interval);
+    tasks_[task].next_tick = std::min(tasks_[task].next_tick, tick_ + tasks_[task].period);
+}
+
+int TickScheduler::update(float dt) {
+    const float interval = 1.0f/tick_rate_;
+    accumulator_ += dt;
+    int due = accumulator_/interval;
+    accumulator_ -= due*interval;
+    if (due > MAX_CATCH_UP_TICKS) {
+        stats_.skipped += due - MAX_CATCH_UP_TICKS;
+        due = MAX_CATCH_UP_TICKS;
+    }
+    for (int i = 0; i < due; i++)
+        run_tick();
+
+    const Clock::time_point now = Clock::now();
+    const float elapsed = std::chrono::duration<float>(now - rate_start_).count();
+    if (elapsed >= 1.0f) {
+        stats_.tick_rate = rate_ticks_/elapsed;
+        rate_start_ = now;
+        rate_ticks_ = 0;
+    }
+    return due;
+}
+
+void TickScheduler::reset() {
+    accumulator_ = 0.0f;
+    tick_ = 0;
+    for (Task& task : tasks_)
+        task.next_tick = task.run_at_start ? 0 : task.period;
+    rate_start_ = Clock::now();
+    rate_ticks_ = 0;
+}
+
+// Percentiles are only worked out when asked for, about once a second for the overlay
+TickStats TickScheduler::get_stats() const {
+    TickStats stats = stats_;
+    if (durations_.empty())
+        return stats;
+    std::vector<float> sorted = durations_;
+    std::sort(sorted.begin(), sorted.end());
+    stats.p50_ms = sorted[(sorted.size() - 1)*50/100];
+    stats.p95_ms = sorted[(sorted.size() - 1)*95/100];
+    stats.max_ms = sorted.back();
+    return stats;
+}
+
+uint64_t TickScheduler::period_of(float interval) const {
+    return std::max<uint64_t>(1, std::llround(interval*tick_rate_));
+}
+
+void TickScheduler::run_tick() {
+    const Clock::time_point start = Clock::now();
+    for (Task& task : tasks_) {
+        if (tick_ < task.next_tick)
+            continue;
+        task.run();
+        task.next_tick = tick_ + task.period;
+    }
+    const float ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    if (durations_.size() < TICK_TIMING_WINDOW) {
+        durations_.push_back(ms);
+    } else {
+        durations_[next_duration_] = ms;
+        next_duration_ = (next_duration_ + 1) % TICK_TIMING_WINDOW;
+    }
+    tick_++;
+    rate_ticks_++;
+    stats_.ticks++;
+}
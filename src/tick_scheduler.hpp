@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+constexpr float DEFAULT_TICK_RATE = 20.0f; // ticks per second
+constexpr int MAX_CATCH_UP_TICKS = 5; // per frame, time beyond that is dropped
+constexpr int TICK_TIMING_WINDOW = 256; // ticks the duration percentiles are taken over
+
+struct TickStats {
+    float tick_rate = 0.0f; // ticks actually run over the last second
+    float p50_ms = 0.0f;
+    float p95_ms = 0.0f;
+    float max_ms = 0.0f;
+    uint64_t ticks = 0;
+    uint64_t skipped = 0; // ticks dropped because a frame fell too far behind
+};
+
+// Fixed-timestep driver for the main thread's periodic work. Frame time is accumulated and spent in whole
+// ticks, the remainder carries over to the next frame so the rate holds however the frame times vary. A
+// frame that falls more than MAX_CATCH_UP_TICKS behind runs those and drops the rest rather than spiralling.
+// Tasks run on their own interval, rounded to whole ticks and at least one.
+class TickScheduler {
+public:
+    explicit TickScheduler(float tick_rate = DEFAULT_TICK_RATE);
+
+    // Keeps the tasks' intervals in seconds
+    void set_tick_rate(float tick_rate);
+    float get_tick_rate() const;
+    // interval 0 runs the task every tick. The first run is on the first tick after a reset, or one interval
+    // later without run_at_start.
+    int add_task(float interval, std::function<void()> task, bool run_at_start = true);
+    void set_task_interval(int task, float interval);
+
+    // Runs the ticks dt adds up to, returns how many ran
+    int update(float dt);
+    // Forgets the accumulated time and restarts every task's schedule, for when the world is (re)entered
+    void reset();
+
+    TickStats get_stats() const;
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Task {
+        float interval;
+        uint64_t period; // in ticks
+        uint64_t next_tick;
+        bool run_at_start;
+        std::function<void()> run;
+    };
+
+    uint64_t period_of(float interval) const;
+    void run_tick();
+
+    float tick_rate_;
+    float accumulator_ = 0.0f; // seconds not yet spent on ticks
+    uint64_t tick_ = 0; // since the last reset
+    std::vector<Task> tasks_;
+
+    TickStats stats_;
+    std::vector<float> durations_; // ring of the last TICK_TIMING_WINDOW tick durations (ms)
+    size_t next_duration_ = 0;
+    Clock::time_point rate_start_ = Clock::now();
+    uint64_t rate_ticks_ = 0; // ticks since rate_start_
+};
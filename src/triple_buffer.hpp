@@ -0,0 +1,34 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread without locks. Each side owns a slot
+// and swaps it with the shared middle one, so the writer never waits and the reader always gets the most
+// recent complete value, skipping any it was too slow to see.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer side, the slot to fill before publish
+    T& write_slot() {return slots_[write_];}
+    void publish() {
+        write_ = middle_.exchange(write_ | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader side. Takes the newest published value if there is one, returns whether there was.
+    bool acquire() {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        read_ = middle_.exchange(read_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& read_slot() const {return slots_[read_];}
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4; // set on the middle slot by publish, cleared by acquire
+
+    std::array<T,3> slots_ {};
+    uint8_t write_ = 0;
+    std::atomic<uint8_t> middle_ = 1;
+    uint8_t read_ = 2;
+};
@@ -1,5 +1,10 @@
+#include <thread>
+
 #include "util.hpp"
 
+// Static initialization runs on the thread that goes on to call main
+static const std::thread::id main_thread_id = std::this_thread::get_id();
+
 std::vector<std::string> split_string(const std::string& data) {
     std::vector<std::string> split;
     int l = 0;
@@ -57,3 +62,16 @@ std::string get_without_first_word(const std::string& data) {
     std::string result = data.substr(r, r - data.size());
     return result;
 }
+
+uint64_t hash_fnv1a(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool is_main_thread() {
+    return std::this_thread::get_id() == main_thread_id;
+}
@@ -1,7 +1,22 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Transparent hash so unordered containers keyed by std::string can be searched with a std::string_view
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view data) const {return std::hash<std::string_view>{}(data);}
+};
+
 std::vector<std::string> split_string(const std::string& data);
 std::string get_first_word(const std::string& data);
-std::string get_without_first_word(const std::string& data);
\ No newline at end of file
+std::string get_without_first_word(const std::string& data);
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+// 64-bit FNV-1a, pass the previous result as hash to continue over several buffers
+uint64_t hash_fnv1a(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS);
+// Whether the caller is the thread that runs main, which owns the GL context
+bool is_main_thread();
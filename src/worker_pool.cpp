@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "worker_pool.hpp"
+
+struct ParallelJob {
+    const std::function<void(size_t)>* task;
+    std::function<void(size_t)> owned_task; // submitted jobs own their task, parallel_for borrows the caller's
+    size_t count;
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> finished = 0;
+    std::exception_ptr error;
+};
+
+struct Pool {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::deque<std::shared_ptr<ParallelJob>> jobs;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    ~Pool() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+};
+
+static Pool& pool() {
+    static Pool instance;
+    return instance;
+}
+
+// Claims indices until none are left, whoever finishes the last one wakes the thread waiting on the job
+static void run_job(Pool& p, ParallelJob& job) {
+    size_t i;
+    while ((i = job.next++) < job.count) {
+        try {
+            (*job.task)(i);
+        } catch (...) {
+            std::lock_guard lock(p.mutex);
+            if (!job.error)
+                job.error = std::current_exception();
+        }
+        if (++job.finished == job.count) {
+            std::lock_guard lock(p.mutex);
+            p.done.notify_all();
+        }
+    }
+}
+
+// Exhausted jobs leave the queue as soon as any thread notices, running tasks still finish
+static void retire_job(Pool& p, const std::shared_ptr<ParallelJob>& job) {
+    auto it = std::find(p.jobs.begin(), p.jobs.end(), job);
+    if (it != p.jobs.end())
+        p.jobs.erase(it);
+}
+
+static void run_worker(Pool& p) {
+    std::unique_lock lock(p.mutex);
+    while (true) {
+        p.wake.wait(lock, [&]() {return p.stopping || !p.jobs.empty();});
+        if (p.stopping)
+            return;
+        std::shared_ptr<ParallelJob> job = p.jobs.front();
+        lock.unlock();
+        run_job(p, *job);
+        lock.lock();
+        retire_job(p, job);
+    }
+}
+
+// Submitted tasks need at least one worker even on a single core since nobody waits on them
+static void start_workers(Pool& p, int minimum) {
+    std::lock_guard lock(p.mutex);
+    size_t count = std::max<int>(std::max<int>(std::thread::hardware_concurrency(), 1) - 1, minimum);
+    while (p.workers.size() < count)
+        p.workers.emplace_back(run_worker, std::ref(p));
+}
+
+void WorkerPool::parallel_for(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0)
+        return;
+    Pool& p = pool();
+    start_workers(p, 0);
+    auto job = std::make_shared<ParallelJob>();
+    job->task = &task;
+    job->count = count;
+    if (count > 1 && !p.workers.empty()) {
+        std::lock_guard lock(p.mutex);
+        p.jobs.push_back(job);
+        p.wake.notify_all();
+    }
+    run_job(p, *job);
+
+    std::unique_lock lock(p.mutex);
+    retire_job(p, job);
+    p.done.wait(lock, [&]() {return job->finished == job->count;});
+    if (job->error)
+        std::rethrow_exception(job->error);
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    Pool& p = pool();
+    start_workers(p, 1);
+    auto job = std::make_shared<ParallelJob>();
+    job->owned_task = [task = std::move(task)](size_t) {task();};
+    job->task = &job->owned_task;
+    job->count = 1;
+    {
+        std::lock_guard lock(p.mutex);
+        p.jobs.push_back(std::move(job));
+    }
+    p.wake.notify_one();
+}
+
+int WorkerPool::thread_count() {
+    Pool& p = pool();
+    start_workers(p, 0);
+    return p.workers.size() + 1;
+}
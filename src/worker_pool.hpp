@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// Process-wide pool of worker threads for CPU work that never touches the GL context. Workers are started
+// on first use, one fewer than the hardware has cores since the calling thread helps out, but at least one
+// once a task is submitted.
+class WorkerPool {
+public:
+    // Runs task(i) for every i in [0, count) across the workers and the calling thread, returning once all
+    // are done. The first exception a task throws is rethrown here after the rest have finished.
+    static void parallel_for(size_t count, const std::function<void(size_t)>& task);
+    // Queues task to run on a worker and returns immediately. Nothing waits on it, so the task has to hand
+    // its result back itself and catch what it throws, anything that escapes is dropped.
+    static void submit(std::function<void()> task);
+    static int thread_count(); // workers plus the calling thread
+};
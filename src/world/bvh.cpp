@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "render/frustum.hpp"
+#include "world/bvh.hpp"
+
+constexpr float FAT_MARGIN = 0.1f;
+
+static BoundingBox merge(const BoundingBox& a, const BoundingBox& b) {
+    return BoundingBox{Vector3{std::min(a.min.x,b.min.x), std::min(a.min.y,b.min.y), std::min(a.min.z,b.min.z)},
+                       Vector3{std::max(a.max.x,b.max.x), std::max(a.max.y,b.max.y), std::max(a.max.z,b.max.z)}};
+}
+
+static float area(const BoundingBox& box) {
+    float dx = box.max.x - box.min.x;
+    float dy = box.max.y - box.min.y;
+    float dz = box.max.z - box.min.z;
+    return 2.0f*(dx*dy + dy*dz + dz*dx);
+}
+
+static bool contains(const BoundingBox& outer, const BoundingBox& inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static bool equals(const BoundingBox& a, const BoundingBox& b) {
+    return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z &&
+           a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+}
+
+static BoundingBox fatten(const BoundingBox& box) {
+    return BoundingBox{Vector3{box.min.x-FAT_MARGIN, box.min.y-FAT_MARGIN, box.min.z-FAT_MARGIN},
+                       Vector3{box.max.x+FAT_MARGIN, box.max.y+FAT_MARGIN, box.max.z+FAT_MARGIN}};
+}
+
+static bool overlaps(const BoundingBox& a, const BoundingBox& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+static bool overlaps_sphere(const BoundingBox& box, Vector3 center, float radius) {
+    float dx = std::max(std::max(box.min.x - center.x, 0.0f), center.x - box.max.x);
+    float dy = std::max(std::max(box.min.y - center.y, 0.0f), center.y - box.max.y);
+    float dz = std::max(std::max(box.min.z - center.z, 0.0f), center.z - box.max.z);
+    return dx*dx + dy*dy + dz*dz <= radius*radius;
+}
+
+// Narrows [t_min, t_max] to one axis' slab. A ray parallel to the slab has an infinite inverse, which would
+// turn an origin lying on a plane into 0*inf = NaN, so it is either inside the slab for its whole length or
+// misses.
+static bool clip_slab(float origin, float inverse_direction, float min, float max, float& t_min, float& t_max) {
+    if (std::isinf(inverse_direction))
+        return origin >= min && origin <= max;
+    float t1 = (min - origin)*inverse_direction;
+    float t2 = (max - origin)*inverse_direction;
+    t_min = std::max(t_min, std::min(t1,t2));
+    t_max = std::min(t_max, std::max(t1,t2));
+    return true;
+}
+
+// Slab test, returns the entry distance along the ray (0 if the origin is inside) or infinity on a miss
+static float ray_box(const Vector3& origin, const Vector3& inverse_direction, const BoundingBox& box) {
+    constexpr float MISS = std::numeric_limits<float>::infinity();
+    float t_min = -MISS;
+    float t_max = MISS;
+    if (!clip_slab(origin.x, inverse_direction.x, box.min.x, box.max.x, t_min, t_max) ||
+        !clip_slab(origin.y, inverse_direction.y, box.min.y, box.max.y, t_min, t_max) ||
+        !clip_slab(origin.z, inverse_direction.z, box.min.z, box.max.z, t_min, t_max))
+        return MISS;
+    if (t_max < 0.0f || t_min > t_max)
+        return MISS;
+    return std::max(t_min, 0.0f);
+}
+
+Bvh::Bvh() : root_(-1), free_list_(-1), leaf_count_(0) {}
+
+int32_t Bvh::insert(uint32_t id, uint32_t mask, BoundingBox box) {
+    int32_t leaf = allocate_node();
+    Node& node = nodes_[leaf];
+    node.box = box;
+    node.fat = fatten(box);
+    node.id = id;
+    node.mask = mask;
+    node.height = 0;
+    insert_leaf(leaf);
+    leaf_count_++;
+    return leaf;
+}
+
+void Bvh::remove(int32_t proxy) {
+    assert(proxy >= 0 && static_cast<size_t>(proxy) < nodes_.size() && nodes_[proxy].is_leaf());
+    remove_leaf(proxy);
+    free_node(proxy);
+    leaf_count_--;
+}
+
+void Bvh::move(int32_t proxy, BoundingBox box) {
+    assert(proxy >= 0 && static_cast<size_t>(proxy) < nodes_.size() && nodes_[proxy].is_leaf());
+    nodes_[proxy].box = box;
+    if (contains(nodes_[proxy].fat, box))
+        return;
+    remove_leaf(proxy);
+    nodes_[proxy].fat = fatten(box);
+    insert_leaf(proxy);
+}
+
+// A leaf still overlapping its old fattened box only grows or slides a little, so refitting its ancestors
+// keeps the tree tight enough without the search and rotations of a reinsert
+void Bvh::set_box(int32_t proxy, BoundingBox box) {
+    assert(proxy >= 0 && static_cast<size_t>(proxy) < nodes_.size() && nodes_[proxy].is_leaf());
+    Node& leaf = nodes_[proxy];
+    leaf.box = box;
+    if (contains(leaf.fat, box))
+        return;
+    if (overlaps(leaf.fat, box)) {
+        leaf.fat = fatten(box);
+        refit_leaves_.push_back(proxy);
+    } else {
+        reinsert_leaves_.push_back(proxy);
+    }
+}
+
+// Walks up from each refit leaf and stops at the first ancestor that does not change, so ancestors shared
+// by many moved leaves are mostly visited once. Reinserts come after, on a tree that is consistent again.
+void Bvh::refit() {
+    for (int32_t leaf : refit_leaves_) {
+        for (int32_t index = nodes_[leaf].parent; index != -1; index = nodes_[index].parent) {
+            Node& node = nodes_[index];
+            const BoundingBox fat = merge(nodes_[node.left].fat, nodes_[node.right].fat);
+            if (equals(fat, node.fat))
+                break;
+            node.fat = fat;
+        }
+    }
+    refit_leaves_.clear();
+    for (int32_t leaf : reinsert_leaves_) {
+        remove_leaf(leaf);
+        nodes_[leaf].fat = fatten(nodes_[leaf].box);
+        insert_leaf(leaf);
+    }
+    reinsert_leaves_.clear();
+}
+
+void Bvh::clear() {
+    nodes_.clear();
+    refit_leaves_.clear();
+    reinsert_leaves_.clear();
+    root_ = -1;
+    free_list_ = -1;
+    leaf_count_ = 0;
+}
+
+int Bvh::size() const {
+    return leaf_count_;
+}
+
+RaycastHit Bvh::raycast(Ray ray, uint32_t mask, uint32_t ignore_id, float max_distance) const {
+    assert(refit_leaves_.empty() && reinsert_leaves_.empty());
+    RaycastHit hit {0, max_distance};
+    if (root_ == -1)
+        return hit;
+    Vector3 inverse_direction = {1.0f/ray.direction.x, 1.0f/ray.direction.y, 1.0f/ray.direction.z};
+    if ((nodes_[root_].mask & mask) == 0 || ray_box(ray.position, inverse_direction, nodes_[root_].fat) > max_distance)
+        return hit;
+    constexpr float MISS = std::numeric_limits<float>::infinity();
+    stack_.clear();
+    stack_.push_back(root_);
+    while (!stack_.empty()) {
+        const Node& node = nodes_[stack_.back()];
+        stack_.pop_back();
+        if (node.is_leaf()) {
+            if (node.id == ignore_id || (node.mask & mask) == 0)
+                continue;
+            // A miss is infinite too, which would pass the distance test when max_distance is
+            float d = ray_box(ray.position, inverse_direction, node.box);
+            if (d != MISS && d <= hit.distance && (hit.id == 0 || d < hit.distance)) {
+                hit.id = node.id;
+                hit.distance = d;
+            }
+            continue;
+        }
+        // Visit the nearer child first so hits found there prune the farther one
+        const Node& left = nodes_[node.left];
+        const Node& right = nodes_[node.right];
+        float d_first = (left.mask & mask) ? ray_box(ray.position, inverse_direction, left.fat) : MISS;
+        float d_second = (right.mask & mask) ? ray_box(ray.position, inverse_direction, right.fat) : MISS;
+        int32_t first = node.left;
+        int32_t second = node.right;
+        if (d_second < d_first) {
+            std::swap(d_first, d_second);
+            std::swap(first, second);
+        }
+        if (d_second != MISS && d_second <= hit.distance)
+            stack_.push_back(second);
+        if (d_first != MISS && d_first <= hit.distance)
+            stack_.push_back(first);
+    }
+    return hit;
+}
+
+void Bvh::query_box(BoundingBox box, uint32_t mask, std::vector<uint32_t>& result) const {
+    assert(refit_leaves_.empty() && reinsert_leaves_.empty());
+    if (root_ == -1)
+        return;
+    stack_.clear();
+    stack_.push_back(root_);
+    while (!stack_.empty()) {
+        const Node& node = nodes_[stack_.back()];
+        stack_.pop_back();
+        if ((node.mask & mask) == 0 || !overlaps(node.fat, box))
+            continue;
+        if (node.is_leaf()) {
+            if (overlaps(node.box, box))
+                result.push_back(node.id);
+        } else {
+            stack_.push_back(node.left);
+            stack_.push_back(node.right);
+        }
+    }
+}
+
+void Bvh::query_sphere(Vector3 center, float radius, uint32_t mask, std::vector<uint32_t>& result) const {
+    assert(refit_leaves_.empty() && reinsert_leaves_.empty());
+    if (root_ == -1)
+        return;
+    stack_.clear();
+    stack_.push_back(root_);
+    while (!stack_.empty()) {
+        const Node& node = nodes_[stack_.back()];
+        stack_.pop_back();
+        if ((node.mask & mask) == 0 || !overlaps_sphere(node.fat, center, radius))
+            continue;
+        if (node.is_leaf()) {
+            if (overlaps_sphere(node.box, center, radius))
+                result.push_back(node.id);
+        } else {
+            stack_.push_back(node.left);
+            stack_.push_back(node.right);
+        }
+    }
+}
+
+void Bvh::query_frustum(const Frustum& frustum, uint32_t mask, std::vector<uint32_t>& result) const {
+    assert(refit_leaves_.empty() && reinsert_leaves_.empty());
+    if (root_ == -1)
+        return;
+    stack_.clear();
+    stack_.push_back(root_);
+    while (!stack_.empty()) {
+        int32_t index = stack_.back();
+        const Node& node = nodes_[index];
+        stack_.pop_back();
+        if ((node.mask & mask) == 0)
+            continue;
+        if (node.is_leaf()) {
+            if (frustum.contains(node.box))
+                result.push_back(node.id);
+            continue;
+        }
+        FrustumTest test = frustum.test(node.fat);
+        if (test == FrustumTest::INSIDE) {
+            collect_leaves(index, mask, result);
+        } else if (test == FrustumTest::INTERSECTS) {
+            stack_.push_back(node.left);
+            stack_.push_back(node.right);
+        }
+    }
+}
+
+// Subtree is known to be fully visible, so skip the plane tests
+void Bvh::collect_leaves(int32_t index, uint32_t mask, std::vector<uint32_t>& result) const {
+    const Node& node = nodes_[index];
+    if ((node.mask & mask) == 0)
+        return;
+    if (node.is_leaf()) {
+        result.push_back(node.id);
+        return;
+    }
+    collect_leaves(node.left, mask, result);
+    collect_leaves(node.right, mask, result);
+}
+
+int32_t Bvh::allocate_node() {
+    int32_t node;
+    if (free_list_ != -1) {
+        node = free_list_;
+        free_list_ = nodes_[node].parent;
+    } else {
+        node = nodes_.size();
+        nodes_.emplace_back();
+    }
+    nodes_[node].parent = -1;
+    nodes_[node].left = -1;
+    nodes_[node].right = -1;
+    nodes_[node].height = 0;
+    nodes_[node].id = 0;
+    nodes_[node].mask = 0;
+    return node;
+}
+
+void Bvh::free_node(int32_t node) {
+    nodes_[node].parent = free_list_;
+    nodes_[node].height = -1;
+    free_list_ = node;
+}
+
+void Bvh::insert_leaf(int32_t leaf) {
+    if (root_ == -1) {
+        root_ = leaf;
+        nodes_[root_].parent = -1;
+        return;
+    }
+
+    // Descend towards the sibling with the cheapest surface area increase
+    BoundingBox leaf_box = nodes_[leaf].fat;
+    int32_t index = root_;
+    while (!nodes_[index].is_leaf()) {
+        const Node& node = nodes_[index];
+        float node_area = area(node.fat);
+        float combined_area = area(merge(node.fat, leaf_box));
+        float cost = 2.0f*combined_area;
+        float inheritance_cost = 2.0f*(combined_area - node_area);
+
+        float child_cost[2];
+        int32_t children[2] = {node.left, node.right};
+        for (int i = 0; i < 2; i++) {
+            const Node& child = nodes_[children[i]];
+            float merged_area = area(merge(leaf_box, child.fat));
+            child_cost[i] = child.is_leaf() ? merged_area + inheritance_cost : merged_area - area(child.fat) + inheritance_cost;
+        }
+
+        if (cost < child_cost[0] && cost < child_cost[1])
+            break;
+        index = child_cost[0] < child_cost[1] ? children[0] : children[1];
+    }
+
+    int32_t sibling = index;
+    int32_t old_parent = nodes_[sibling].parent;
+    int32_t new_parent = allocate_node();
+    nodes_[new_parent].parent = old_parent;
+    nodes_[new_parent].fat = merge(leaf_box, nodes_[sibling].fat);
+    nodes_[new_parent].height = nodes_[sibling].height + 1;
+    nodes_[new_parent].mask = nodes_[sibling].mask | nodes_[leaf].mask;
+    nodes_[new_parent].left = sibling;
+    nodes_[new_parent].right = leaf;
+    nodes_[sibling].parent = new_parent;
+    nodes_[leaf].parent = new_parent;
+
+    if (old_parent != -1) {
+        if (nodes_[old_parent].left == sibling)
+            nodes_[old_parent].left = new_parent;
+        else
+            nodes_[old_parent].right = new_parent;
+    } else {
+        root_ = new_parent;
+    }
+
+    refit_ancestors(nodes_[leaf].parent);
+}
+
+void Bvh::remove_leaf(int32_t leaf) {
+    if (leaf == root_) {
+        root_ = -1;
+        return;
+    }
+
+    int32_t parent = nodes_[leaf].parent;
+    int32_t grand_parent = nodes_[parent].parent;
+    int32_t sibling = nodes_[parent].left == leaf ? nodes_[parent].right : nodes_[parent].left;
+
+    if (grand_parent != -1) {
+        if (nodes_[grand_parent].left == parent)
+            nodes_[grand_parent].left = sibling;
+        else
+            nodes_[grand_parent].right = sibling;
+        nodes_[sibling].parent = grand_parent;
+        free_node(parent);
+        refit_ancestors(grand_parent);
+    } else {
+        root_ = sibling;
+        nodes_[sibling].parent = -1;
+        free_node(parent);
+    }
+}
+
+void Bvh::refit_ancestors(int32_t index) {
+    while (index != -1) {
+        index = balance(index);
+        Node& node = nodes_[index];
+        const Node& left = nodes_[node.left];
+        const Node& right = nodes_[node.right];
+        node.height = 1 + std::max(left.height, right.height);
+        node.fat = merge(left.fat, right.fat);
+        node.mask = left.mask | right.mask;
+        index = node.parent;
+    }
+}
+
+// Rotates the subtree rooted at a if it is imbalanced, returning the new subtree root
+int32_t Bvh::balance(int32_t a) {
+    Node& A = nodes_[a];
+    if (A.is_leaf() || A.height < 2)
+        return a;
+
+    int32_t b = A.left;
+    int32_t c = A.right;
+    int32_t imbalance = nodes_[c].height - nodes_[b].height;
+
+    if (imbalance > 1 || imbalance < -1) {
+        // Promote the taller child (up) and move a down under it
+        int32_t up = imbalance > 1 ? c : b;
+        int32_t other = imbalance > 1 ? b : c;
+        Node& U = nodes_[up];
+        int32_t f = U.left;
+        int32_t g = U.right;
+
+        U.left = a;
+        U.parent = A.parent;
+        A.parent = up;
+        if (U.parent != -1) {
+            if (nodes_[U.parent].left == a)
+                nodes_[U.parent].left = up;
+            else
+                nodes_[U.parent].right = up;
+        } else {
+            root_ = up;
+        }
+
+        // Keep the taller grandchild under up, hand the shorter one to a
+        int32_t keep = nodes_[f].height > nodes_[g].height ? f : g;
+        int32_t give = keep == f ? g : f;
+        U.right = keep;
+        if (imbalance > 1)
+            A.right = give;
+        else
+            A.left = give;
+        nodes_[give].parent = a;
+
+        A.fat = merge(nodes_[other].fat, nodes_[give].fat);
+        A.mask = nodes_[other].mask | nodes_[give].mask;
+        A.height = 1 + std::max(nodes_[other].height, nodes_[give].height);
+        U.fat = merge(A.fat, nodes_[keep].fat);
+        U.mask = A.mask | nodes_[keep].mask;
+        U.height = 1 + std::max(A.height, nodes_[keep].height);
+        return up;
+    }
+    return a;
+}
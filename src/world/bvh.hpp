@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "raylib.h"
+
+class Frustum;
+
+struct RaycastHit {
+    uint32_t id; // 0 if nothing was hit
+    float distance;
+};
+
+// Dynamic AABB tree over world objects. Leaves keep the tight box for exact tests and a fattened box
+// for the tree, so small moves only update the leaf instead of restructuring the tree.
+class Bvh {
+public:
+    Bvh();
+
+    int32_t insert(uint32_t id, uint32_t mask, BoundingBox box);
+    void remove(int32_t proxy);
+    void move(int32_t proxy, BoundingBox box);
+    // move for many leaves at once, the tree is only brought up to date by the refit that must follow
+    // before the next query
+    void set_box(int32_t proxy, BoundingBox box);
+    void refit();
+    void clear();
+    int size() const;
+
+    RaycastHit raycast(Ray ray, uint32_t mask, uint32_t ignore_id, float max_distance) const;
+    void query_box(BoundingBox box, uint32_t mask, std::vector<uint32_t>& result) const;
+    void query_sphere(Vector3 center, float radius, uint32_t mask, std::vector<uint32_t>& result) const;
+    void query_frustum(const Frustum& frustum, uint32_t mask, std::vector<uint32_t>& result) const;
+private:
+    struct Node {
+        BoundingBox fat;
+        BoundingBox box;
+        int32_t parent;
+        int32_t left;
+        int32_t right;
+        int32_t height; // -1 when on the free list
+        uint32_t id;
+        uint32_t mask; // union of children masks for internal nodes
+        bool is_leaf() const {return left == -1;}
+    };
+
+    int32_t allocate_node();
+    void free_node(int32_t node);
+    void insert_leaf(int32_t leaf);
+    void remove_leaf(int32_t leaf);
+    void refit_ancestors(int32_t node);
+    int32_t balance(int32_t node);
+    void collect_leaves(int32_t node, uint32_t mask, std::vector<uint32_t>& result) const;
+
+    std::vector<Node> nodes_;
+    int32_t root_;
+    int32_t free_list_;
+    int leaf_count_;
+    std::vector<int32_t> refit_leaves_; // left their fattened box, still close to it
+    std::vector<int32_t> reinsert_leaves_; // left it far behind
+    mutable std::vector<int32_t> stack_;
+};
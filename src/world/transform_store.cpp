@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cassert>
+
+#include "raylib.h"
+#include "raymath.h"
+
+#include "object/object3d.hpp"
+#include "world/transform_store.hpp"
+
+// Inputs are gathered into packed arrays before the batch so the arithmetic runs over contiguous floats
+enum BatchArray {X, Y, Z, QX, QY, QZ, QW, S, M0, M1, M2, M4, M5, M6, M8, M9, M10, BATCH_ARRAYS};
+
+TransformStore::TransformStore() : any_dirty_(false) {}
+
+int32_t TransformStore::add(Object3d* object) {
+    int32_t node = add(TRANSFORM_NONE, object->get_matrix());
+    objects_.back() = object;
+    return node;
+}
+
+int32_t TransformStore::add(int32_t parent, const Matrix& local) {
+    int32_t parent_slot = TRANSFORM_NONE;
+    if (parent != TRANSFORM_NONE) {
+        assert(static_cast<size_t>(parent) < slot_.size() && slot_[parent] != TRANSFORM_NONE);
+        parent_slot = slot_[parent];
+    }
+    int32_t node;
+    if (!free_handles_.empty()) {
+        node = free_handles_.back();
+        free_handles_.pop_back();
+    } else {
+        node = slot_.size();
+        slot_.push_back(TRANSFORM_NONE);
+    }
+    // Appending keeps the order since the parent is already in the arrays
+    slot_[node] = parent_.size();
+    parent_.push_back(parent_slot);
+    local_.push_back(local);
+    world_.push_back(local);
+    dirty_.push_back(true);
+    objects_.push_back(nullptr);
+    handle_.push_back(node);
+    marked_.push_back(false);
+    any_dirty_ = true;
+    return node;
+}
+
+// Descendants all sit after the node, so one pass finds them and a second compacts the arrays in order
+void TransformStore::remove(int32_t node) {
+    assert(static_cast<size_t>(node) < slot_.size() && slot_[node] != TRANSFORM_NONE);
+    const size_t first = slot_[node];
+    std::vector<int32_t> moved_to(parent_.size() - first, 0); // new slot, or TRANSFORM_NONE if removed
+    moved_to[0] = TRANSFORM_NONE;
+    int32_t next = first;
+    for (size_t i = first + 1; i < parent_.size(); i++) {
+        const int32_t parent = parent_[i];
+        if (parent != TRANSFORM_NONE && static_cast<size_t>(parent) >= first && moved_to[parent - first] == TRANSFORM_NONE)
+            moved_to[i - first] = TRANSFORM_NONE;
+        else
+            moved_to[i - first] = next++;
+    }
+    for (size_t i = first; i < parent_.size(); i++) {
+        const int32_t to = moved_to[i - first];
+        const int32_t handle = handle_[i];
+        if (to == TRANSFORM_NONE) {
+            if (marked_[i]) {
+                objects_[i]->update_matrix();
+                std::erase(pending_, handle);
+            }
+            slot_[handle] = TRANSFORM_NONE;
+            free_handles_.push_back(handle);
+            continue;
+        }
+        const int32_t parent = parent_[i];
+        parent_[to] = parent != TRANSFORM_NONE && static_cast<size_t>(parent) >= first ? moved_to[parent - first] : parent;
+        local_[to] = local_[i];
+        world_[to] = world_[i];
+        dirty_[to] = dirty_[i];
+        objects_[to] = objects_[i];
+        handle_[to] = handle;
+        marked_[to] = marked_[i];
+        slot_[handle] = to;
+    }
+    parent_.resize(next);
+    local_.resize(next);
+    world_.resize(next);
+    dirty_.resize(next);
+    objects_.resize(next);
+    handle_.resize(next);
+    marked_.resize(next);
+}
+
+void TransformStore::clear() {
+    parent_.clear();
+    local_.clear();
+    world_.clear();
+    dirty_.clear();
+    objects_.clear();
+    handle_.clear();
+    marked_.clear();
+    slot_.clear();
+    free_handles_.clear();
+    pending_.clear();
+    any_dirty_ = false;
+}
+
+size_t TransformStore::size() const {
+    return parent_.size();
+}
+
+void TransformStore::mark(int32_t node) {
+    const int32_t slot = slot_[node];
+    assert(objects_[slot] != nullptr);
+    if (!marked_[slot]) {
+        marked_[slot] = true;
+        pending_.push_back(node);
+    }
+}
+
+void TransformStore::set_local(int32_t node, const Matrix& local) {
+    const int32_t slot = slot_[node];
+    local_[slot] = local;
+    dirty_[slot] = true;
+    any_dirty_ = true;
+}
+
+const Matrix& TransformStore::get_local(int32_t node) const {
+    return local_[slot_[node]];
+}
+
+const Matrix& TransformStore::get_world(int32_t node) const {
+    return world_[slot_[node]];
+}
+
+int TransformStore::get_pending() const {
+    return pending_.size();
+}
+
+// Upper 3x3 of every matrix, rotation (as QuaternionToMatrix) times scale. Restrict only reliably reaches
+// the vectorizer through parameters, so the arrays are passed in separately.
+static void compose_rotation_scale(int n, const float* __restrict qx, const float* __restrict qy, const float* __restrict qz,
+        const float* __restrict qw, const float* __restrict s, float* __restrict m0, float* __restrict m1, float* __restrict m2,
+        float* __restrict m4, float* __restrict m5, float* __restrict m6, float* __restrict m8, float* __restrict m9, float* __restrict m10) {
+    for (int i = 0; i < n; i++) {
+        float a2 = qx[i]*qx[i];
+        float b2 = qy[i]*qy[i];
+        float c2 = qz[i]*qz[i];
+        float ac = qx[i]*qz[i];
+        float ab = qx[i]*qy[i];
+        float bc = qy[i]*qz[i];
+        float ad = qw[i]*qx[i];
+        float bd = qw[i]*qy[i];
+        float cd = qw[i]*qz[i];
+        m0[i] = s[i]*(1 - 2*(b2 + c2));
+        m1[i] = s[i]*(2*(ab + cd));
+        m2[i] = s[i]*(2*(ac - bd));
+        m4[i] = s[i]*(2*(ab - cd));
+        m5[i] = s[i]*(1 - 2*(a2 + c2));
+        m6[i] = s[i]*(2*(bc + ad));
+        m8[i] = s[i]*(2*(ac + bd));
+        m9[i] = s[i]*(2*(bc - ad));
+        m10[i] = s[i]*(1 - 2*(a2 + b2));
+    }
+}
+
+// Objects first, same result as Object3d::update_matrix, scale then rotation then translation written out
+// per element. Their matrix_changed may set locals below them, which the pass that follows picks up. A
+// recomputed node stays marked for the rest of that pass so its children follow.
+int TransformStore::update(std::vector<Object3d*>& moved) {
+    const int n = pending_.size();
+    if (n > 0) {
+        batch_.resize(n*BATCH_ARRAYS);
+        float* a[BATCH_ARRAYS];
+        for (int i = 0; i < BATCH_ARRAYS; i++)
+            a[i] = batch_.data() + i*n;
+        for (int i = 0; i < n; i++) {
+            const Object3d& object = *objects_[slot_[pending_[i]]];
+            a[X][i] = object.position_.x;
+            a[Y][i] = object.position_.y;
+            a[Z][i] = object.position_.z;
+            a[QX][i] = object.quaternion_.x;
+            a[QY][i] = object.quaternion_.y;
+            a[QZ][i] = object.quaternion_.z;
+            a[QW][i] = object.quaternion_.w;
+            a[S][i] = object.scale_;
+        }
+
+        compose_rotation_scale(n, a[QX], a[QY], a[QZ], a[QW], a[S], a[M0], a[M1], a[M2], a[M4], a[M5], a[M6], a[M8], a[M9], a[M10]);
+
+        for (int i = 0; i < n; i++) {
+            const int32_t slot = slot_[pending_[i]];
+            marked_[slot] = false;
+            local_[slot] = Matrix{
+                a[M0][i], a[M4][i], a[M8][i], a[X][i],
+                a[M1][i], a[M5][i], a[M9][i], a[Y][i],
+                a[M2][i], a[M6][i], a[M10][i], a[Z][i],
+                0.0f, 0.0f, 0.0f, 1.0f
+            };
+            dirty_[slot] = true;
+            objects_[slot]->set_matrix(local_[slot]);
+            moved.push_back(objects_[slot]);
+        }
+        pending_.clear();
+        any_dirty_ = true;
+    }
+
+    if (!any_dirty_)
+        return n;
+    for (size_t i = 0; i < parent_.size(); i++) {
+        const int32_t parent = parent_[i];
+        if (parent == TRANSFORM_NONE) {
+            if (dirty_[i])
+                world_[i] = local_[i];
+        } else if (dirty_[i] || dirty_[parent]) {
+            world_[i] = MatrixMultiply(local_[i], world_[parent]);
+            dirty_[i] = true;
+        }
+    }
+    std::fill(dirty_.begin(), dirty_.end(), false);
+    any_dirty_ = false;
+    return n;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "raylib.h"
+
+class Object3d;
+
+constexpr int32_t TRANSFORM_NONE = -1;
+
+// Every transform in a World in flat arrays ordered so every parent comes before its children. Objects are
+// roots whose local matrix is composed from the position, rotation and scale they keep themselves. Plain
+// nodes (petal placements, a player and their hand) take a local matrix and may hang off anything. Writes
+// only mark the node. update gathers the marked objects into structure of arrays and composes them in one
+// batch the compiler can vectorize, hands them their matrices, then brings world matrices up to date in one
+// linear pass over the marked nodes and everything below them. Nodes are handles that stay valid until
+// removed.
+class TransformStore {
+public:
+    TransformStore();
+
+    int32_t add(Object3d* object);
+    // The parent must already exist, which is what keeps parents ahead of children
+    int32_t add(int32_t parent, const Matrix& local);
+    // And everything below it. A change still pending for a removed object is applied before letting go.
+    void remove(int32_t node);
+    void clear();
+    size_t size() const;
+
+    // The object's position, rotation or scale changed
+    void mark(int32_t node);
+    void set_local(int32_t node, const Matrix& local);
+    const Matrix& get_local(int32_t node) const;
+    // Local composed with every ancestor, as MatrixMultiply(local, parent world), as of the last update
+    const Matrix& get_world(int32_t node) const;
+    int get_pending() const;
+    // Appends the objects whose matrix was rebuilt to moved and returns how many there were
+    int update(std::vector<Object3d*>& moved);
+private:
+    // Per slot, slots are dense and in parent before child order
+    std::vector<int32_t> parent_; // slot of the parent or TRANSFORM_NONE
+    std::vector<Matrix> local_;
+    std::vector<Matrix> world_;
+    std::vector<uint8_t> dirty_;
+    std::vector<Object3d*> objects_; // null for plain nodes
+    std::vector<int32_t> handle_; // handle owning the slot
+    std::vector<uint8_t> marked_; // object with a position, rotation or scale not yet composed
+
+    std::vector<int32_t> slot_; // per handle, TRANSFORM_NONE when free
+    std::vector<int32_t> free_handles_;
+    std::vector<int32_t> pending_; // handles of marked objects in the order they were first written
+    std::vector<float> batch_; // packed inputs and outputs of one compose
+    bool any_dirty_;
+};
@@ -5,8 +5,11 @@
 #include "object/consistent/move_tool.hpp"
 #include "object/consistent/sun_tool.hpp"
 #include "object/consistent/rotate_tool.hpp"
+#include "object/consistent/parameter_tool.hpp"
 #include "object/procedural/tapered_petal.hpp"
 #include "world/world.hpp"
+#include "render/mesh_queue.hpp"
+#include "worker_pool.hpp"
 #include <cstdint>
 #include "util.hpp"
 #include <algorithm>
@@ -22,6 +25,10 @@ World::World() {
     sun_ = std::make_shared<Cube>(Vector3{0.0f,SUN_RADIUS,0.0f}, Vector3{1.0f,1.0f,1.0f}, 10.0f, WHITE);
 };
 
+World::~World() {
+    clear_index();
+}
+
 void World::load_world(std::string save_file, std::shared_ptr<Shader> shader) {
     reset_world();
     std::ifstream file (save_file);
@@ -37,6 +44,7 @@ void World::load_world(std::string save_file, std::shared_ptr<Shader> shader) {
         load_object(std::make_shared<MoveTool>(Vector3{0.0f, 2.0f, 0.0f}, 1.0f), shader);
         load_object(std::make_shared<SunTool>(Vector3{0.0f, 2.0f, 3.0f}, 1.0f), shader);
         load_object(std::make_shared<RotateTool>(Vector3{0.0f, 2.0f, 4.0f}, 1.0f), shader);
+        load_object(std::make_shared<ParameterTool>(Vector3{0.0f, 2.0f, 5.0f}, 1.0f), shader);
     }
 }
 
@@ -47,8 +55,10 @@ void World::save_world(std::string save_file) const {
 }
 
 void World::reset_world() {
+    clear_index();
     objects_.clear();
     players_.clear();
+    player_ids_.clear();
     next_id_ = 1;
 }
 
@@ -73,32 +83,63 @@ std::string World::to_string() const {
     return result;
 }
 
+// Procedural objects only build CPU-side data when constructed, so these can be made on worker threads
+static std::shared_ptr<ParameterObject> make_procedural_object(const std::string& data) {
+    std::string type = get_first_word(data);
+    if (type == "TaperedPetal")
+        return std::make_shared<TaperedPetal>(data);
+    if (type == "LilyFlower")
+        return std::make_shared<LilyFlower>(data);
+    return nullptr;
+}
+
+// These upload their meshes through AssetCache when constructed and must be made on the main thread
+static std::shared_ptr<Object3d> make_consistent_object(const std::string& data) {
+    std::string type = get_first_word(data);
+    if (type == "Cube")
+        return std::make_shared<Cube>(data);
+    if (type == "MoveTool")
+        return std::make_shared<MoveTool>(data);
+    if (type == "SunTool")
+        return std::make_shared<SunTool>(data);
+    if (type == "RotateTool")
+        return std::make_shared<RotateTool>(data);
+    if (type == "ParameterTool")
+        return std::make_shared<ParameterTool>(data);
+    return nullptr;
+}
+
 void World::from_string(std::string data, std::shared_ptr<Shader> shader) {
     std::vector<std::string> split = split_string(data);
     next_id_ = std::stoi(split[1]);
     std::vector<std::string> object_data = split_string(split[2]);
     std::vector<std::string> player_data = split_string(split[3]);
-    for (const std::string& data : object_data) {
-        std::vector<std::string> object_split = split_string(data);
-        std::string type = get_first_word(object_split[1]);
-        std::shared_ptr<Object3d> object;
-        if (type == "Cube") {
-            object = std::make_shared<Cube>(object_split[1]);
-        } else if (type == "MoveTool") {
-            object = std::make_shared<MoveTool>(object_split[1]);
-        } else if (type == "SunTool") {
-            object = std::make_shared<SunTool>(object_split[1]);
-        } else if (type == "RotateTool") {
-            object = std::make_shared<RotateTool>(object_split[1]);
-        } else if (type == "TaperedPetal") {
-            object = std::make_shared<TaperedPetal>(object_split[1]);
-            std::dynamic_pointer_cast<TaperedPetal>(object)->generate_mesh();
-        } else if (type == "LilyFlower") {
-            object = std::make_shared<LilyFlower>(object_split[1]);
-            std::dynamic_pointer_cast<LilyFlower>(object)->generate_mesh();
+
+    // Records are parsed and procedural meshes prepared on the worker pool. Consistent objects are made and
+    // everything is indexed here in record order, the prepared meshes are left to MeshQueue, which uploads
+    // them in per-frame batches, since only this thread may touch the GL context.
+    std::vector<uint32_t> ids(object_data.size());
+    std::vector<std::string> records(object_data.size());
+    std::vector<std::shared_ptr<Object3d>> objects(object_data.size());
+    WorkerPool::parallel_for(object_data.size(), [&](size_t i) {
+        std::vector<std::string> object_split = split_string(object_data[i]);
+        ids[i] = std::stoi(object_split[0]);
+        records[i] = std::move(object_split[1]);
+        std::shared_ptr<ParameterObject> procedural = make_procedural_object(records[i]);
+        if (procedural != nullptr) {
+            procedural->prepare_mesh();
+            objects[i] = std::move(procedural);
         }
+    });
+    for (size_t i = 0; i < objects.size(); i++) {
+        std::shared_ptr<Object3d> object = objects[i];
+        if (object == nullptr)
+            object = make_consistent_object(records[i]);
         object->set_shader(shader);
-        objects_[std::stoi(object_split[0])] = object;
+        objects_[ids[i]] = object;
+        index_object(ids[i]);
+        if (auto procedural = std::dynamic_pointer_cast<ParameterObject>(object))
+            MeshQueue::enqueue_prepared(procedural);
     }
     for (const std::string& data : player_data) {
         load_player(std::make_shared<Player>(data), shader);
@@ -109,6 +150,7 @@ void World::from_string(std::string data, std::shared_ptr<Shader> shader) {
 uint32_t World::load_object(std::shared_ptr<Object3d> object, std::shared_ptr<Shader> shader) {
     objects_[next_id_++] = std::move(object);
     objects_[next_id_-1]->set_shader(shader);
+    index_object(next_id_-1);
     return next_id_-1;
 }
 
@@ -116,20 +158,25 @@ void World::load_object(std::shared_ptr<Object3d> object, uint32_t id, std::shar
     assert(objects_.find(id) == objects_.end());
     objects_[id] = std::move(object);
     objects_[id]->set_shader(shader);
+    index_object(id);
     next_id_ = std::max(id+1, next_id_);
 }
 
 void World::load_player(std::string username, std::shared_ptr<Shader> shader) {
-    if (get_player(username) == nullptr) {
+    if (get_player_id(username) == 0) {
         players_.push_back(std::make_shared<Player>(username, spawn_point_));
         players_.back()->set_shader(shader);
+        players_.back()->set_transform_store(&transform_store_);
+        player_ids_.emplace(std::move(username), players_.size());
     }
 }
 
 void World::load_player(std::shared_ptr<Player> player, std::shared_ptr<Shader> shader) {
-    if (get_player(player->get_username()) == nullptr) {
+    if (get_player_id(player->get_username()) == 0) {
+        player_ids_.emplace(player->get_username(), players_.size()+1);
         players_.push_back(std::move(player));
         players_.back()->set_shader(shader);
+        players_.back()->set_transform_store(&transform_store_);
     }
 }
 
@@ -143,21 +190,106 @@ void World::update_object(uint32_t id, Quaternion quaternion) {
     objects_[id]->set_quaternion(quaternion);
 }
 
+void World::update_object(uint32_t id, int part, std::string_view parameter, float value) {
+    if(objects_.find(id) == objects_.end()) return;
+    auto procedural = std::dynamic_pointer_cast<ParameterObject>(objects_[id]);
+    if (procedural == nullptr || procedural->get_part(part) == nullptr) return;
+    procedural->get_part(part)->set_parameter(parameter, value);
+    procedural->update_mesh();
+}
+
 uint32_t World::get_object_id(std::shared_ptr<Object3d> object) {
-    for (const auto& p : objects_) {
-        if (object.get() == p.second.get()) {
-            return p.first;
-        }
-    }
+    auto it = objects_.find(object->get_id());
+    if (it != objects_.end() && it->second.get() == object.get())
+        return it->first;
     return 0;
 }
 
 void World::remove_object(uint32_t id) {
     if (id != 0) {
-        objects_.erase(id);
+        auto it = objects_.find(id);
+        if (it == objects_.end())
+            return;
+        bvh_.remove(it->second->get_bvh_proxy());
+        it->second->set_bvh_proxy(nullptr, -1);
+        transform_store_.remove(it->second->get_transform_node());
+        it->second->set_transform_node(nullptr, TRANSFORM_NONE);
+        static_batches_.remove(id);
+        it->second->set_id(0);
+        objects_.erase(it);
     }
 }
 
+RaycastHit World::raycast(Ray ray, RaycastFilter filter, float max_distance) {
+    update_transforms();
+    return bvh_.raycast(ray, filter.mask, filter.ignore_id, max_distance);
+}
+
+std::vector<uint32_t> World::query_box(BoundingBox box, uint32_t mask) {
+    update_transforms();
+    std::vector<uint32_t> result;
+    bvh_.query_box(box, mask, result);
+    return result;
+}
+
+std::vector<uint32_t> World::query_sphere(Vector3 center, float radius, uint32_t mask) {
+    update_transforms();
+    std::vector<uint32_t> result;
+    bvh_.query_sphere(center, radius, mask, result);
+    return result;
+}
+
+void World::cull(const Frustum& frustum, std::vector<uint32_t>& visible) {
+    update_transforms();
+    visible.clear();
+    bvh_.query_frustum(frustum, OBJECT_MASK_ALL, visible);
+}
+
+// Leaves are set first and the tree refit once, instead of walking up from every moved leaf
+int World::update_transforms() {
+    moved_.clear();
+    const int count = transform_store_.update(moved_);
+    for (Object3d* object : moved_)
+        bvh_.set_box(object->get_bvh_proxy(), object->get_bounding_box());
+    bvh_.refit();
+    return count;
+}
+
+void World::update_static_batches(double time, float budget_ms) {
+    static_batches_.update(time, budget_ms);
+}
+
+const StaticBatcher& World::get_static_batches() const {
+    return static_batches_;
+}
+
+void World::index_object(uint32_t id) {
+    const std::shared_ptr<Object3d>& object = objects_.at(id);
+    if (object->get_bvh_proxy() != -1)
+        return;
+    uint32_t mask = dynamic_cast<Item*>(object.get()) != nullptr ? OBJECT_MASK_ITEM : OBJECT_MASK_SCENERY;
+    object->set_id(id);
+    object->set_bvh_proxy(&bvh_, bvh_.insert(id, mask, object->get_bounding_box()));
+    object->set_transform_node(&transform_store_, transform_store_.add(object.get()));
+    static_batches_.add(id, object.get());
+}
+
+// Objects can outlive the world (held items, pending events), so they must not keep pointing into bvh_.
+// Pending moves are applied first, removing node by node would compact the store once per object.
+void World::clear_index() {
+    update_transforms();
+    for (const auto& p : objects_) {
+        p.second->set_bvh_proxy(nullptr, -1);
+        p.second->set_transform_node(nullptr, TRANSFORM_NONE);
+        p.second->set_id(0);
+    }
+    for (const auto& player : players_)
+        player->set_transform_store(nullptr);
+    bvh_.clear();
+    transform_store_.clear();
+    static_batches_.clear();
+}
+
 const std::map<uint32_t, std::shared_ptr<Object3d>>& World::get_objects() const {
     return objects_;
 }
@@ -165,12 +297,19 @@ const std::map<uint32_t, std::shared_ptr<Object3d>>& World::get_objects() const
 const std::vector<std::shared_ptr<Player>>& World::get_players() const {
     return players_;
 }
-const std::shared_ptr<Player> World::get_player(std::string username) const {
-    for (const auto& player : players_) {
-        if (player->get_username() == username)
-            return player;
-    }
-    return nullptr;
+const std::shared_ptr<Player> World::get_player(std::string_view username) const {
+    return get_player(get_player_id(username));
+}
+
+const std::shared_ptr<Player> World::get_player(uint32_t player_id) const {
+    if (player_id == 0 || player_id > players_.size())
+        return nullptr;
+    return players_[player_id-1];
+}
+
+uint32_t World::get_player_id(std::string_view username) const {
+    auto it = player_ids_.find(username);
+    return it == player_ids_.end() ? 0 : it->second;
 }
 
 std::shared_ptr<Weather> World::get_weather() {
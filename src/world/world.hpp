@@ -2,18 +2,35 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 #include "raylib.h"
 
 #include "object/object3d.hpp"
 #include "player/player.hpp"
+#include "render/frustum.hpp"
+#include "render/static_batcher.hpp"
+#include "util.hpp"
+#include "world/bvh.hpp"
+#include "world/transform_store.hpp"
 #include "world/weather.hpp"
 
+constexpr uint32_t OBJECT_MASK_SCENERY = 1 << 0;
+constexpr uint32_t OBJECT_MASK_ITEM = 1 << 1;
+constexpr uint32_t OBJECT_MASK_ALL = ~0u;
+
+struct RaycastFilter {
+    uint32_t mask = OBJECT_MASK_ALL;
+    uint32_t ignore_id = 0;
+};
+
 class World {
 public:
     World();
+    ~World();
     
     void load_world(std::string save_file, std::shared_ptr<Shader> shader);
     void save_world(std::string save_file) const;
@@ -29,20 +46,45 @@ public:
     void load_player(std::shared_ptr<Player> player, std::shared_ptr<Shader> shader);
     void update_object(uint32_t id, Vector3 position);
     void update_object(uint32_t id, Quaternion quaternion);
+    // Sets a parameter of a part of a procedural object and rebuilds what it affects
+    void update_object(uint32_t id, int part, std::string_view parameter, float value);
     uint32_t get_object_id(std::shared_ptr<Object3d> object);
     void remove_object(uint32_t id);
 
+    // Queries run update_transforms first, so objects moved earlier in the same frame or tick are found
+    // where they are now
+    RaycastHit raycast(Ray ray, RaycastFilter filter, float max_distance);
+    std::vector<uint32_t> query_box(BoundingBox box, uint32_t mask);
+    std::vector<uint32_t> query_sphere(Vector3 center, float radius, uint32_t mask);
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible);
+    // Composes the matrices of objects moved since the last call and refits their leaves, once per frame
+    // before drawing. Returns the number of objects updated.
+    int update_transforms();
+    // Merges objects that stopped changing into per-region batches, after update_transforms. time in seconds.
+    void update_static_batches(double time, float budget_ms);
+    const StaticBatcher& get_static_batches() const;
+
     const std::map<uint32_t, std::shared_ptr<Object3d>>& get_objects() const;
     const std::vector<std::shared_ptr<Player>>& get_players() const;
-    const std::shared_ptr<Player> get_player(std::string username) const;
+    const std::shared_ptr<Player> get_player(std::string_view username) const;
+    const std::shared_ptr<Player> get_player(uint32_t player_id) const;
+    uint32_t get_player_id(std::string_view username) const; // 0 if not found, stable until reset_world
     std::shared_ptr<Weather> get_weather();
     std::shared_ptr<Object3d> get_sun();
     void update_sun();
 private:
+    void index_object(uint32_t id);
+    void clear_index();
+
     uint32_t next_id_;
     std::shared_ptr<Weather> weather_;
     std::map<uint32_t, std::shared_ptr<Object3d>> objects_;
+    Bvh bvh_;
+    TransformStore transform_store_;
+    std::vector<Object3d*> moved_; // by the last update_transforms
+    StaticBatcher static_batches_;
     std::vector<std::shared_ptr<Player>> players_;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> player_ids_; // username -> index into players_ + 1
     std::shared_ptr<Object3d> sun_;
     Vector3 spawn_point_;
 };
\ No newline at end of file
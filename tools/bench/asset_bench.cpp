@@ -0,0 +1,94 @@
+// Construction time, resident mesh memory and draw calls for a garden of tools, cubes and repeated lily
+// cultivars, with meshes and materials shared through AssetCache. The unshared figures are what the same
+// objects took when each one uploaded its own mesh plus the placeholder cube every Object3d used to make.
+#include <cstdio>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "object/consistent/cube.hpp"
+#include "object/consistent/move_tool.hpp"
+#include "object/consistent/rotate_tool.hpp"
+#include "object/consistent/sun_tool.hpp"
+#include "object/procedural/lily_flower.hpp"
+#include "render/asset_cache.hpp"
+#include "render/instance_batcher.hpp"
+#include "rlgl.h"
+
+#include "bench.hpp"
+
+int main() {
+    constexpr int TOOLS = 2500; // of each kind
+    constexpr int CULTIVARS = 4;
+    constexpr int FLOWERS = 400;
+    open_bench_window();
+
+    std::vector<std::shared_ptr<Object3d>> objects;
+    BenchClock::time_point start = BenchClock::now();
+    for (int i = 0; i < TOOLS; i++) {
+        const Vector3 position = {(float)(i % 50), 0.0f, (float)(i/50)};
+        const float size = 0.5f + 0.25f*(i % 4);
+        objects.push_back(std::make_shared<Cube>(position, Vector3{size, size, size}, 1.0f, RED));
+        objects.push_back(std::make_shared<MoveTool>(position, 1.0f));
+        objects.push_back(std::make_shared<RotateTool>(position, 1.0f));
+        objects.push_back(std::make_shared<SunTool>(position, 1.0f));
+    }
+    const float tools_ms = elapsed_ms(start);
+
+    start = BenchClock::now();
+    std::vector<std::string> cultivars;
+    for (int i = 0; i < CULTIVARS; i++)
+        cultivars.push_back(LilyFlower(Vector3{0.0f, 0.0f, 0.0f}, 1.0f).to_string());
+    for (int i = 0; i < FLOWERS; i++) {
+        auto flower = std::make_shared<LilyFlower>(cultivars[i % CULTIVARS]);
+        flower->set_position(Vector3{(float)(i % 20), 0.0f, (float)(i/20)});
+        flower->generate_mesh();
+        objects.push_back(flower);
+    }
+    const float flowers_ms = elapsed_ms(start);
+
+    // Shared: every distinct mesh once. Unshared: every object its own copy plus a 1x1x1 placeholder cube.
+    Mesh placeholder = GenMeshCube(1.0f, 1.0f, 1.0f);
+    const size_t placeholder_bytes = mesh_bytes(placeholder);
+    UnloadMesh(placeholder);
+    std::unordered_set<const Mesh*> unique;
+    size_t shared_bytes = 0;
+    size_t unshared_bytes = 0;
+    auto count_mesh = [&](const std::shared_ptr<const Mesh>& mesh) {
+        if (mesh == nullptr)
+            return;
+        unshared_bytes += mesh_bytes(*mesh);
+        if (unique.insert(mesh.get()).second)
+            shared_bytes += mesh_bytes(*mesh);
+    };
+    for (const auto& object : objects) {
+        unshared_bytes += placeholder_bytes;
+        if (auto flower = std::dynamic_pointer_cast<LilyFlower>(object)) {
+            count_mesh(flower->get_upper_petal().get_mesh());
+            count_mesh(flower->get_lower_petal().get_mesh());
+        } else {
+            count_mesh(object->get_mesh());
+        }
+    }
+
+    InstanceBatcher batcher(std::make_shared<Shader>(Shader{rlGetShaderIdDefault(), rlGetShaderLocsDefault()}));
+    batcher.begin(LodView{Vector3{0.0f, 2.0f, -10.0f}, 1000.0f});
+    start = BenchClock::now();
+    for (const auto& object : objects)
+        object->submit(batcher);
+    batcher.flush();
+    const float submit_ms = elapsed_ms(start);
+    const RenderQueueStats& draws = batcher.get_queue_stats();
+
+    std::printf("%d tools and cubes in %.1f ms (%.1f us each), %d flowers of %d cultivars in %.1f ms\n",
+                TOOLS*4, tools_ms, tools_ms*1000.0f/(TOOLS*4), FLOWERS, CULTIVARS, flowers_ms);
+    std::printf("%d meshes and %d materials resident for %zu objects\n", AssetCache::mesh_count(), AssetCache::material_count(), objects.size());
+    std::printf("mesh memory %.2f MB shared, %.2f MB unshared (%.0f vs %.0f bytes per object)\n",
+                shared_bytes/1048576.0, unshared_bytes/1048576.0, (double)shared_bytes/objects.size(), (double)unshared_bytes/objects.size());
+    std::printf("%d draws for %zu objects (%d shader, %d material, %d mesh binds), submitted in %.2f ms\n",
+                draws.draws, objects.size(), draws.shader_binds, draws.material_binds, draws.mesh_binds, submit_ms);
+
+    objects.clear();
+    CloseWindow();
+    return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+#include "raylib.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+inline float elapsed_ms(BenchClock::time_point start) {
+    return std::chrono::duration<float, std::milli>(BenchClock::now() - start).count();
+}
+
+// Benchmarks that upload meshes only need the GL context, the window stays hidden
+inline void open_bench_window() {
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(64, 64, "bench");
+}
+
+// Buffer bytes of a float format mesh, from the CPU-side arrays raylib keeps next to the upload
+inline size_t mesh_bytes(const Mesh& mesh) {
+    size_t bytes = 0;
+    if (mesh.vertices != nullptr)
+        bytes += mesh.vertexCount*3*sizeof(float);
+    if (mesh.texcoords != nullptr)
+        bytes += mesh.vertexCount*2*sizeof(float);
+    if (mesh.normals != nullptr)
+        bytes += mesh.vertexCount*3*sizeof(float);
+    if (mesh.colors != nullptr)
+        bytes += mesh.vertexCount*4;
+    if (mesh.indices != nullptr)
+        bytes += mesh.triangleCount*3*sizeof(unsigned short);
+    return bytes;
+}
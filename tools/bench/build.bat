@@ -0,0 +1,12 @@
+set GAME=src/game.cpp src/network_thread.cpp src/tick_scheduler.cpp src/util.cpp src/worker_pool.cpp src/event/*.cpp src/network/*.cpp src/object/*.cpp src/object/consistent/*.cpp src/object/procedural/*.cpp src/player/*.cpp src/render/*.cpp src/world/*.cpp
+set FLAGS=-O3 -DNDEBUG -D_WIN32_WINNT=0x0A00 -DWINVER=0x0A00 -static -Isrc -Iinclude -Itools/bench -std=c++20
+set LIBS=-Llib -lssl -lcrypto -lcrypt32 -lraylib -lopengl32 -lgdi32 -lenet -lwinmm -lws2_32
+g++ %FLAGS% tools/bench/pick_bench.cpp src/world/bvh.cpp src/render/frustum.cpp -o pick_bench.exe
+g++ %FLAGS% tools/bench/cull_bench.cpp src/world/bvh.cpp src/render/frustum.cpp -o cull_bench.exe
+g++ %FLAGS% tools/bench/asset_bench.cpp %GAME% %LIBS% -o asset_bench.exe
+g++ %FLAGS% tools/bench/tessellation_bench.cpp %GAME% %LIBS% -o tessellation_bench.exe
+g++ %FLAGS% tools/bench/mesh_format_bench.cpp %GAME% %LIBS% -o mesh_format_bench.exe
+g++ %FLAGS% tools/bench/world_load_bench.cpp %GAME% %LIBS% -o world_load_bench.exe
+g++ %FLAGS% tools/bench/lily_move_bench.cpp %GAME% %LIBS% -o lily_move_bench.exe
+g++ %FLAGS% tools/bench/transform_bench.cpp %GAME% %LIBS% -o transform_bench.exe
+PAUSE
@@ -0,0 +1,73 @@
+// Frustum culling through the world BVH against testing every box, from a camera turning on the spot in
+// the middle of the garden. Headless, only needs the raylib headers.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "raylib.h"
+#include "raymath.h"
+#include "rlgl.h"
+
+#include "render/frustum.hpp"
+#include "world/bvh.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+int main() {
+    constexpr int VIEWS = 64;
+    for (int count : {10000, 50000, 100000}) {
+        std::mt19937 rng(count);
+        const float extent = std::sqrt((float)count)*2.0f;
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::vector<BoundingBox> boxes;
+        Bvh bvh;
+        for (int i = 0; i < count; i++) {
+            Vector3 min = {position(rng), 0.0f, position(rng)};
+            boxes.push_back(BoundingBox{min, Vector3{min.x + 1.0f, 1.0f, min.z + 1.0f}});
+            bvh.insert(i + 1, 1, boxes.back());
+        }
+
+        std::vector<Frustum> frustums;
+        for (int i = 0; i < VIEWS; i++) {
+            const float yaw = 2.0f*PI*i/VIEWS;
+            Matrix view = MatrixLookAt(Vector3{0.0f, 1.7f, 0.0f}, Vector3{std::cos(yaw), 1.5f, std::sin(yaw)}, Vector3{0.0f, 1.0f, 0.0f});
+            Matrix projection = MatrixPerspective(45.0f*DEG2RAD, 16.0f/9.0f, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+            frustums.push_back(Frustum(MatrixMultiply(view, projection)));
+        }
+
+        std::vector<uint32_t> visible;
+        size_t visible_total = 0;
+        Clock::time_point start = Clock::now();
+        for (const Frustum& frustum : frustums) {
+            visible.clear();
+            bvh.query_frustum(frustum, 1, visible);
+            visible_total += visible.size();
+        }
+        const float bvh_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count()/VIEWS;
+
+        std::vector<std::vector<uint32_t>> expected(VIEWS);
+        start = Clock::now();
+        for (int view = 0; view < VIEWS; view++) {
+            for (size_t i = 0; i < boxes.size(); i++) {
+                if (frustums[view].contains(boxes[i]))
+                    expected[view].push_back(i + 1);
+            }
+        }
+        const float brute_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count()/VIEWS;
+
+        int mismatches = 0;
+        for (int view = 0; view < VIEWS; view++) {
+            visible.clear();
+            bvh.query_frustum(frustums[view], 1, visible);
+            std::sort(visible.begin(), visible.end());
+            mismatches += visible != expected[view];
+        }
+
+        std::printf("%6d objects: %zu visible on average, cull %.3f ms (every box %.3f ms), %d/%d views mismatched\n",
+                    count, visible_total/VIEWS, bvh_ms, brute_ms, mismatches, VIEWS);
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+// Moves per second of a LilyFlower as in a MoveTool drag, with the cached petal placement against a pitch set
+// before every move, which redoes the placement each time like every move did before it was cached.
+#include <cstdio>
+
+#include "raylib.h"
+
+#include "object/procedural/lily_flower.hpp"
+
+#include "bench.hpp"
+
+constexpr int MOVES = 1000000;
+
+static float drag(LilyFlower& flower, bool repitch) {
+    const float pitch = flower.get_parameter("PetalPitchUpper").value;
+    float sink = 0.0f;
+    BenchClock::time_point start = BenchClock::now();
+    for (int i = 0; i < MOVES; i++) {
+        if (repitch)
+            flower.set_parameter("PetalPitchUpper", pitch);
+        flower.set_position(Vector3{(float)(i & 255)*0.01f, 0.0f, (float)((i >> 8) & 255)*0.01f});
+        sink += flower.get_bounding_box().max.x;
+    }
+    const float ms = elapsed_ms(start);
+    std::printf("%-20s %6.2f M moves/s, %6.1f ns per move (%g)\n", repitch ? "placement each move" : "cached placement",
+                MOVES/ms/1000.0f, ms*1e6f/MOVES, sink);
+    return ms;
+}
+
+int main() {
+    open_bench_window();
+    LilyFlower flower(Vector3{0.0f, 0.0f, 0.0f}, 1.0f);
+    flower.generate_mesh();
+    const float cached_ms = drag(flower, false);
+    const float repitch_ms = drag(flower, true);
+    std::printf("cached moves are %.1fx faster\n", repitch_ms/cached_ms);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// Ray picking through the world BVH against a brute-force scan of every box, at garden sizes from 10k up.
+// Headless, only needs the raylib headers.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "world/bvh.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Reference slab test written for clarity, dividing per axis and handling parallel rays explicitly
+static bool reference_hit(Ray ray, const BoundingBox& box, float& distance) {
+    const float origin[3] = {ray.position.x, ray.position.y, ray.position.z};
+    const float direction[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+    const float min[3] = {box.min.x, box.min.y, box.min.z};
+    const float max[3] = {box.max.x, box.max.y, box.max.z};
+    float enter = -std::numeric_limits<float>::infinity();
+    float exit = std::numeric_limits<float>::infinity();
+    for (int axis = 0; axis < 3; axis++) {
+        if (direction[axis] == 0.0f) {
+            if (origin[axis] < min[axis] || origin[axis] > max[axis])
+                return false;
+            continue;
+        }
+        float t1 = (min[axis] - origin[axis])/direction[axis];
+        float t2 = (max[axis] - origin[axis])/direction[axis];
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+    }
+    if (exit < 0.0f || enter > exit)
+        return false;
+    distance = std::max(enter, 0.0f);
+    return true;
+}
+
+static float brute_force(const std::vector<BoundingBox>& boxes, Ray ray, uint32_t& id) {
+    float nearest = std::numeric_limits<float>::infinity();
+    id = 0;
+    for (size_t i = 0; i < boxes.size(); i++) {
+        float distance;
+        if (reference_hit(ray, boxes[i], distance) && distance < nearest) {
+            nearest = distance;
+            id = i + 1;
+        }
+    }
+    return nearest;
+}
+
+static BoundingBox random_box(std::mt19937& rng, float extent) {
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> size(0.2f, 2.0f);
+    Vector3 min = {position(rng), size(rng)*0.5f, position(rng)};
+    return BoundingBox{min, Vector3{min.x + size(rng), min.y + size(rng), min.z + size(rng)}};
+}
+
+int main() {
+    constexpr int RAYS = 2000;
+    for (int count : {10000, 20000, 50000, 100000}) {
+        std::mt19937 rng(count);
+        const float extent = std::sqrt((float)count)*2.0f;
+        std::vector<BoundingBox> boxes;
+        std::vector<int32_t> proxies;
+        Bvh bvh;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < count; i++) {
+            boxes.push_back(random_box(rng, extent));
+            proxies.push_back(bvh.insert(i + 1, 1, boxes.back()));
+        }
+        const float insert_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+        // A drag: small moves that mostly stay inside the fattened leaf
+        std::uniform_real_distribution<float> nudge(-0.05f, 0.05f);
+        start = Clock::now();
+        for (int i = 0; i < count; i++) {
+            const float dx = nudge(rng);
+            const float dz = nudge(rng);
+            boxes[i].min.x += dx; boxes[i].max.x += dx;
+            boxes[i].min.z += dz; boxes[i].max.z += dz;
+            bvh.move(proxies[i], boxes[i]);
+        }
+        const float move_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+        // Player-height rays in random directions, plus axis-aligned rays starting on a box face
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+        std::vector<Ray> rays;
+        for (int i = 0; i < RAYS; i++) {
+            if (i % 4 == 0) {
+                const BoundingBox& box = boxes[rng() % count];
+                rays.push_back(Ray{Vector3{box.min.x, (box.min.y + box.max.y)*0.5f, box.min.z - 5.0f}, Vector3{0.0f, 0.0f, 1.0f}});
+            } else {
+                Vector3 d = {direction(rng), direction(rng)*0.2f, direction(rng)};
+                const float length = std::sqrt(d.x*d.x + d.y*d.y + d.z*d.z);
+                rays.push_back(Ray{Vector3{position(rng), 1.7f, position(rng)}, Vector3{d.x/length, d.y/length, d.z/length}});
+            }
+        }
+
+        std::vector<RaycastHit> hits(RAYS);
+        start = Clock::now();
+        for (int i = 0; i < RAYS; i++)
+            hits[i] = bvh.raycast(rays[i], 1, 0, std::numeric_limits<float>::infinity());
+        const float bvh_us = std::chrono::duration<float, std::micro>(Clock::now() - start).count()/RAYS;
+
+        int mismatches = 0;
+        start = Clock::now();
+        for (int i = 0; i < RAYS; i++) {
+            uint32_t id;
+            const float distance = brute_force(boxes, rays[i], id);
+            if ((id == 0) != (hits[i].id == 0) || (id != 0 && std::abs(distance - hits[i].distance) > 1e-3f))
+                mismatches++;
+        }
+        const float brute_us = std::chrono::duration<float, std::micro>(Clock::now() - start).count()/RAYS;
+
+        std::printf("%6d objects: insert %.1f ms, move all %.1f ms, raycast %.2f us (scan %.1f us), %d/%d mismatches\n",
+                    count, insert_ms, move_ms, bvh_us, brute_us, mismatches, RAYS);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Triangles, surface error and build time of adaptive petal tessellation at a range of tolerances, next to a
+// uniform grid with about as many triangles. Error is the largest distance from a full grid sample to the
+// built surface, measured on freckle-free copies so freckle fans cannot hide it.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "raylib.h"
+#include "raymath.h"
+
+#include "object/procedural/tapered_petal.hpp"
+
+#include "bench.hpp"
+
+// Closest point on triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5)
+static Vector3 closest_on_triangle(Vector3 p, Vector3 a, Vector3 b, Vector3 c) {
+    Vector3 ab = Vector3Subtract(b, a), ac = Vector3Subtract(c, a), ap = Vector3Subtract(p, a);
+    float d1 = Vector3DotProduct(ab, ap), d2 = Vector3DotProduct(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return a;
+    Vector3 bp = Vector3Subtract(p, b);
+    float d3 = Vector3DotProduct(ab, bp), d4 = Vector3DotProduct(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return b;
+    float vc = d1*d4 - d3*d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return Vector3Add(a, Vector3Scale(ab, d1/(d1 - d3)));
+    Vector3 cp = Vector3Subtract(p, c);
+    float d5 = Vector3DotProduct(ab, cp), d6 = Vector3DotProduct(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return c;
+    float vb = d5*d2 - d1*d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return Vector3Add(a, Vector3Scale(ac, d2/(d2 - d6)));
+    float va = d3*d6 - d5*d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return Vector3Add(b, Vector3Scale(Vector3Subtract(c, b), (d4 - d3)/((d4 - d3) + (d5 - d6))));
+    float denom = 1.0f/(va + vb + vc);
+    return Vector3Add(a, Vector3Add(Vector3Scale(ab, vb*denom), Vector3Scale(ac, vc*denom)));
+}
+
+static Vector3 vertex(const MeshData& data, int index) {
+    return Vector3{data.vertices[index*3], data.vertices[index*3+1], data.vertices[index*3+2]};
+}
+
+// Largest distance from any vertex of reference to the surface of mesh
+static float surface_error(const MeshData& reference, const MeshData& mesh) {
+    float error = 0.0f;
+    for (int v = 0; v < reference.vertex_count(); v++) {
+        const Vector3 p = vertex(reference, v);
+        float nearest = std::numeric_limits<float>::infinity();
+        for (int t = 0; t < mesh.triangle_count() && nearest > error; t++) {
+            Vector3 q = closest_on_triangle(p, vertex(mesh, mesh.indices[t*3]), vertex(mesh, mesh.indices[t*3+1]), vertex(mesh, mesh.indices[t*3+2]));
+            nearest = std::min(nearest, Vector3Distance(p, q));
+        }
+        error = std::max(error, nearest);
+    }
+    return error;
+}
+
+static TaperedPetal make_petal(uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    ParameterMap map(PETAL_SCHEMA);
+    map.seed(rng);
+    return TaperedPetal(map, seed, QuaternionIdentity(), Vector3{0.0f, 0.0f, 0.0f}, 1.0f);
+}
+
+int main() {
+    constexpr int PETALS = 100;
+    const float TOLERANCES[] = {0.0005f, 0.001f, 0.002f, 0.005f, 0.01f};
+    open_bench_window();
+
+    std::vector<TaperedPetal> petals;
+    std::vector<TaperedPetal> plain; // freckle-free copies for the error measurement
+    for (int i = 0; i < PETALS; i++) {
+        petals.push_back(make_petal(i + 1));
+        plain.push_back(make_petal(i + 1));
+        plain.back().set_parameter("FreckleAmount", 0.0f);
+        petals.back().set_single_sided(true);
+        plain.back().set_single_sided(true);
+    }
+
+    std::vector<MeshData> reference;
+    long full_triangles = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (TaperedPetal& petal : petals)
+        full_triangles += petal.build_mesh().triangle_count();
+    const float full_ms = elapsed_ms(start)/PETALS;
+    for (TaperedPetal& petal : plain)
+        reference.push_back(petal.build_mesh());
+    std::printf("full grid 40x20: %ld triangles per petal, %.3f ms per build\n", full_triangles/PETALS, full_ms);
+
+    for (float tolerance : TOLERANCES) {
+        long triangles = 0;
+        start = BenchClock::now();
+        for (TaperedPetal& petal : petals) {
+            petal.set_tessellation_tolerance(tolerance);
+            triangles += petal.build_mesh().triangle_count();
+        }
+        const float adaptive_ms = elapsed_ms(start)/PETALS;
+
+        long surface_triangles = 0;
+        float adaptive_error = 0.0f;
+        float uniform_error = 0.0f;
+        for (int i = 0; i < PETALS; i++) {
+            plain[i].set_tessellation_tolerance(tolerance);
+            MeshData adaptive = plain[i].build_mesh();
+            surface_triangles += adaptive.triangle_count();
+            adaptive_error = std::max(adaptive_error, surface_error(reference[i], adaptive));
+
+            // Uniform grid with the same 2:1 aspect and about as many triangles
+            plain[i].set_tessellation_tolerance(0.0f);
+            int columns = std::clamp((int)std::lround(std::sqrt(adaptive.triangle_count()/4.0f)), 1, 20);
+            uniform_error = std::max(uniform_error, surface_error(reference[i], plain[i].build_mesh({2*columns, columns})));
+        }
+        std::printf("tolerance %.4f: %5ld triangles per petal (%4ld surface), max error %.5f (uniform grid %.5f), %.3f ms per build\n",
+                    tolerance, triangles/PETALS, surface_triangles/PETALS, adaptive_error, uniform_error, adaptive_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+// Moving and rotating 100k cubes every frame, and 1k of them: composed and refit one setter at a time as
+// objects outside a World do, against a World marking them and running update_transforms once per frame.
+// Box queries against every cube's bounds afterwards check the refit tree.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "raylib.h"
+
+#include "object/consistent/cube.hpp"
+#include "rlgl.h"
+#include "world/bvh.hpp"
+#include "world/world.hpp"
+
+#include "bench.hpp"
+
+constexpr int OBJECTS = 100000;
+constexpr int FRAMES = 20;
+constexpr int QUERIES = 200;
+
+struct Frame {
+    Vector3 nudge;
+    float angle;
+};
+
+static std::vector<std::shared_ptr<Cube>> make_cubes() {
+    std::vector<std::shared_ptr<Cube>> cubes;
+    const int side = std::sqrt((float)OBJECTS);
+    for (int i = 0; i < OBJECTS; i++)
+        cubes.push_back(std::make_shared<Cube>(Vector3{(float)(i % side)*2.0f, 0.0f, (float)(i/side)*2.0f}, Vector3{1.0f, 1.0f, 1.0f}, 1.0f, WHITE));
+    return cubes;
+}
+
+static void move(Cube& cube, const Frame& frame) {
+    const Vector3 position = cube.get_position();
+    cube.set_position(Vector3{position.x + frame.nudge.x, position.y, position.z + frame.nudge.z});
+    cube.rotate_axis(Vector3{0.0f, 1.0f, 0.0f}, frame.angle);
+}
+
+// Every setter composes the matrix and moves the leaf right away
+static float immediate(const std::vector<Frame>& frames, int stride) {
+    std::vector<std::shared_ptr<Cube>> cubes = make_cubes();
+    Bvh bvh;
+    std::vector<int32_t> proxies;
+    for (int i = 0; i < OBJECTS; i++)
+        proxies.push_back(bvh.insert(i + 1, 1, cubes[i]->get_bounding_box()));
+    BenchClock::time_point start = BenchClock::now();
+    for (const Frame& frame : frames) {
+        for (int i = 0; i < OBJECTS; i += stride) {
+            const Vector3 position = cubes[i]->get_position();
+            cubes[i]->set_position(Vector3{position.x + frame.nudge.x, position.y, position.z + frame.nudge.z});
+            bvh.move(proxies[i], cubes[i]->get_bounding_box());
+            cubes[i]->rotate_axis(Vector3{0.0f, 1.0f, 0.0f}, frame.angle);
+            bvh.move(proxies[i], cubes[i]->get_bounding_box());
+        }
+    }
+    return elapsed_ms(start)/frames.size();
+}
+
+static float batched(const std::vector<Frame>& frames, int stride, int& mismatches) {
+    std::vector<std::shared_ptr<Cube>> cubes = make_cubes();
+    World world;
+    auto shader = std::make_shared<Shader>(Shader{rlGetShaderIdDefault(), rlGetShaderLocsDefault()});
+    for (const auto& cube : cubes)
+        world.load_object(cube, shader);
+    world.update_transforms();
+    BenchClock::time_point start = BenchClock::now();
+    for (const Frame& frame : frames) {
+        for (int i = 0; i < OBJECTS; i += stride)
+            move(*cubes[i], frame);
+        world.update_transforms();
+    }
+    const float ms = elapsed_ms(start)/frames.size();
+
+    std::mt19937 rng(stride);
+    std::uniform_real_distribution<float> corner(0.0f, std::sqrt((float)OBJECTS)*2.0f);
+    mismatches = 0;
+    for (int q = 0; q < QUERIES; q++) {
+        const Vector3 min = {corner(rng), -1.0f, corner(rng)};
+        const BoundingBox box = {min, Vector3{min.x + 8.0f, 1.0f, min.z + 8.0f}};
+        std::vector<uint32_t> found = world.query_box(box, OBJECT_MASK_ALL);
+        std::vector<uint32_t> expected;
+        for (const auto& cube : cubes) {
+            const BoundingBox bounds = cube->get_bounding_box();
+            if (bounds.min.x <= box.max.x && bounds.max.x >= box.min.x && bounds.min.y <= box.max.y &&
+                bounds.max.y >= box.min.y && bounds.min.z <= box.max.z && bounds.max.z >= box.min.z)
+                expected.push_back(cube->get_id());
+        }
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        mismatches += found != expected;
+    }
+    return ms;
+}
+
+int main() {
+    open_bench_window();
+    std::mt19937 rng(OBJECTS);
+    std::uniform_real_distribution<float> nudge(-0.05f, 0.05f);
+    std::vector<Frame> frames;
+    for (int i = 0; i < FRAMES; i++)
+        frames.push_back(Frame{Vector3{nudge(rng), 0.0f, nudge(rng)}, nudge(rng)});
+
+    for (int stride : {1, 100}) {
+        const int moved = OBJECTS/stride;
+        const float immediate_ms = immediate(frames, stride);
+        int mismatches;
+        const float batched_ms = batched(frames, stride, mismatches);
+        std::printf("%6d of %d moved: immediate %6.2f ms/frame (%5.2f M/s), batched %6.2f ms/frame (%5.2f M/s), %d/%d queries mismatched\n",
+                    moved, OBJECTS, immediate_ms, moved/immediate_ms/1000.0f, batched_ms, moved/batched_ms/1000.0f, mismatches, QUERIES);
+    }
+    return 0;
+}
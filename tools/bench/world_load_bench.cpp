@@ -0,0 +1,68 @@
+// Loading a synthetic save of 5000 lilies: World::from_string, which parses and prepares meshes on the worker
+// pool, then the frames MeshQueue takes to upload them at the game's 2 ms budget. Distinct lilies with a cold
+// and a warm disk cache, and the same count drawn from a few cultivars so identical meshes are built once.
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "object/procedural/lily_flower.hpp"
+#include "render/asset_cache.hpp"
+#include "render/mesh_disk_cache.hpp"
+#include "render/mesh_queue.hpp"
+#include "rlgl.h"
+#include "worker_pool.hpp"
+#include "world/world.hpp"
+
+#include "bench.hpp"
+
+constexpr int FLOWERS = 5000;
+constexpr float UPLOAD_BUDGET_MS = 2.0f;
+
+static std::string make_save(int cultivars) {
+    std::vector<std::string> records;
+    for (int i = 0; i < cultivars; i++)
+        records.push_back(LilyFlower(Vector3{0.0f, 0.0f, 0.0f}, 1.0f).to_string());
+    std::string objects;
+    for (int i = 0; i < FLOWERS; i++) {
+        LilyFlower flower(records.empty() ? LilyFlower(Vector3{0.0f, 0.0f, 0.0f}, 1.0f).to_string() : records[i % cultivars]);
+        flower.set_position(Vector3{(float)(i % 71), 0.0f, (float)(i/71)});
+        objects += "(" + std::to_string(i + 1) + " (" + flower.to_string() + "))";
+    }
+    return "World " + std::to_string(FLOWERS + 1) + " (" + objects + ")() 30.0 -97.0";
+}
+
+static void load(const char* name, const std::string& save, const std::shared_ptr<Shader>& shader) {
+    World world;
+    BenchClock::time_point start = BenchClock::now();
+    world.from_string(save, shader);
+    const float parse_ms = elapsed_ms(start);
+
+    int frames = 0;
+    start = BenchClock::now();
+    while (MeshQueue::get_stats().queued > 0) {
+        MeshQueue::update(UPLOAD_BUDGET_MS);
+        frames++;
+    }
+    const float upload_ms = elapsed_ms(start);
+    std::printf("%-22s from_string %7.1f ms, uploads %7.1f ms over %4d frames, %5d meshes\n",
+                name, parse_ms, upload_ms, frames, AssetCache::mesh_count());
+}
+
+int main() {
+    open_bench_window();
+    const std::filesystem::path cache = std::filesystem::temp_directory_path() / "world_load_bench";
+    std::filesystem::remove_all(cache);
+    MeshDiskCache::open(cache, 1ull << 32);
+    auto shader = std::make_shared<Shader>(Shader{rlGetShaderIdDefault(), rlGetShaderLocsDefault()});
+    std::printf("%d threads\n", WorkerPool::thread_count());
+
+    const std::string distinct = make_save(0);
+    load("distinct, cold cache", distinct, shader);
+    load("distinct, warm cache", distinct, shader);
+    MeshDiskCache::close();
+    load("8 cultivars, no cache", make_save(8), shader);
+    std::filesystem::remove_all(cache);
+    return 0;
+}